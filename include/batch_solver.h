@@ -0,0 +1,150 @@
+#ifndef BATCH_SOLVER_H_
+#define BATCH_SOLVER_H_
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "cube_state.h"
+#include "cube_moves.h"
+#include "reduction.h"
+#include "thread_pool.h"
+#include "two_phase.h"
+
+/*
+ * Solver for streams of scrambles, e.g. files holding millions of them.
+ *
+ * Every input line is a scramble in standard notation, every output line
+ * the solution of the input line at the same position, in the same
+ * notation. Lines that can not be parsed or solved give "error", with the
+ * reason on std::cerr.
+ *
+ * The calling thread reads, parses and writes; solves run on a ThreadPool
+ * sharing one set of tables. At most window scrambles are in flight, so
+ * memory stays bounded however long the input, and solutions leave in
+ * input order even though they finish out of order.
+ */
+class BatchSolver {
+public:
+    struct Stats {
+        std::size_t solved = 0;
+        std::size_t failed = 0;
+        double seconds = 0;   // wall time of the whole run
+        double p50_ms = 0;    // time to solve a single scramble
+        double p99_ms = 0;
+
+        double throughput() const { return seconds > 0 ? solved / seconds : 0; }
+    };
+
+    /*
+     * @param rank: rank of the scrambled cubes
+     * @param window: most scrambles read but not yet written
+     */
+    BatchSolver(const TwoPhaseTables& tables_, ThreadPool& pool_, int rank_ = 3, std::size_t window_ = 1024):
+        tables(tables_), pool(pool_), rank(rank_), window(std::max<std::size_t>(1, window_)) {}
+
+    Stats run(std::istream& in, std::ostream& out){
+        typedef std::chrono::steady_clock Clock;
+        Clock::time_point start = Clock::now();
+
+        slots.assign(window, Slot());
+        latencies.clear();
+        Stats stats;
+        std::size_t next_in = 0, next_out = 0;
+        std::string line;
+        while(std::getline(in, line)){
+            if(next_in - next_out == window) write(next_out++, out, stats);
+
+            Slot& slot = slots[next_in % window];
+            slot.scramble.clear();
+            slot.done = false;
+            if(!parseMoves(line, rank, slot.scramble)){
+                std::cerr << "Invalid scramble on line " << next_in + 1 << "." << std::endl;
+                slot.ok = false;
+                slot.parsed = false;
+                slot.done = true;
+            }
+            else{
+                slot.parsed = true;
+                pool.submit([this, &slot]{ solve(slot); });
+            }
+            ++next_in;
+        }
+        while(next_out != next_in) write(next_out++, out, stats);
+        out.flush();
+
+        stats.seconds = std::chrono::duration<double>(Clock::now() - start).count();
+        stats.p50_ms = percentile(0.50);
+        stats.p99_ms = percentile(0.99);
+        return stats;
+    }
+
+private:
+    struct Slot {
+        std::vector<Move> scramble;
+        std::string solution;
+        double ms = 0;
+        bool parsed = false;
+        bool ok = false;
+        bool done = false;
+    };
+
+    const TwoPhaseTables& tables;
+    ThreadPool& pool;
+    int rank;
+    std::size_t window;
+    std::vector<Slot> slots;
+    std::vector<double> latencies;
+    std::mutex mutex;
+    std::condition_variable finished;
+
+    // runs on a worker, the slot is not touched by the reader until done
+    void solve(Slot& slot){
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        CubeState state(rank);
+        applyMoves(state, slot.scramble);
+        std::vector<Move> moves;
+        ReductionSolver solver(tables);
+        bool ok = solver.solve(state, moves);
+        std::string text = ok ? formatMoves(moves, rank) : "";
+        double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+        std::lock_guard<std::mutex> lock(mutex);
+        slot.solution = std::move(text);
+        slot.ms = ms;
+        slot.ok = ok;
+        slot.done = true;
+        finished.notify_all();
+    }
+
+    void write(std::size_t ix, std::ostream& out, Stats& stats){
+        Slot& slot = slots[ix % window];
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            finished.wait(lock, [&slot]{ return slot.done; });
+        }
+        if(slot.ok){
+            out << slot.solution << '\n';
+            latencies.push_back(slot.ms);
+            ++stats.solved;
+        }
+        else{
+            if(slot.parsed) std::cerr << "Failed to solve the scramble on line " << ix + 1 << "." << std::endl;
+            out << "error\n";
+            ++stats.failed;
+        }
+    }
+
+    double percentile(double p){
+        if(latencies.empty()) return 0;
+        std::vector<double>::iterator nth = latencies.begin() + static_cast<std::size_t>(p * (latencies.size() - 1));
+        std::nth_element(latencies.begin(), nth, latencies.end());
+        return *nth;
+    }
+};
+
+#endif
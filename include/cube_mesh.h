@@ -0,0 +1,93 @@
+#ifndef CUBE_MESH_H_
+#define CUBE_MESH_H_
+
+#include <glm/glm.hpp>
+
+/*
+ * Geometry of the unit cube centered at the origin, shared by every cube.
+ * 6 vertices per face in Face order, each vertex being
+ * position (3 floats), texture coordinates (2) and normal (3).
+ */
+struct CubeMesh {
+    static constexpr int NUM_VERTICES = 36;
+    static constexpr int STRIDE = 8;
+
+    static constexpr float vertices[NUM_VERTICES * STRIDE] = {
+        /* vertices              texture      normal */
+        // Back face
+        -0.5f, -0.5f, -0.5f,  0.0f, 0.0f,   0.0f,  0.0f, -1.0f,
+         0.5f, -0.5f, -0.5f,  1.0f, 0.0f,   0.0f,  0.0f, -1.0f,
+         0.5f,  0.5f, -0.5f,  1.0f, 1.0f,   0.0f,  0.0f, -1.0f,
+         0.5f,  0.5f, -0.5f,  1.0f, 1.0f,   0.0f,  0.0f, -1.0f,
+        -0.5f,  0.5f, -0.5f,  0.0f, 1.0f,   0.0f,  0.0f, -1.0f,
+        -0.5f, -0.5f, -0.5f,  0.0f, 0.0f,   0.0f,  0.0f, -1.0f,
+
+        // Front face
+        -0.5f, -0.5f,  0.5f,  0.0f, 0.0f,   0.0f,  0.0f,  1.0f,
+         0.5f, -0.5f,  0.5f,  1.0f, 0.0f,   0.0f,  0.0f,  1.0f,
+         0.5f,  0.5f,  0.5f,  1.0f, 1.0f,   0.0f,  0.0f,  1.0f,
+         0.5f,  0.5f,  0.5f,  1.0f, 1.0f,   0.0f,  0.0f,  1.0f,
+        -0.5f,  0.5f,  0.5f,  0.0f, 1.0f,   0.0f,  0.0f,  1.0f,
+        -0.5f, -0.5f,  0.5f,  0.0f, 0.0f,   0.0f,  0.0f,  1.0f,
+
+        // Left face
+        -0.5f,  0.5f,  0.5f,  1.0f, 0.0f,  -1.0f,  0.0f,  0.0f,
+        -0.5f,  0.5f, -0.5f,  1.0f, 1.0f,  -1.0f,  0.0f,  0.0f,
+        -0.5f, -0.5f, -0.5f,  0.0f, 1.0f,  -1.0f,  0.0f,  0.0f,
+        -0.5f, -0.5f, -0.5f,  0.0f, 1.0f,  -1.0f,  0.0f,  0.0f,
+        -0.5f, -0.5f,  0.5f,  0.0f, 0.0f,  -1.0f,  0.0f,  0.0f,
+        -0.5f,  0.5f,  0.5f,  1.0f, 0.0f,  -1.0f,  0.0f,  0.0f,
+
+        // Right face
+         0.5f,  0.5f,  0.5f,  1.0f, 0.0f,   1.0f,  0.0f,  0.0f,
+         0.5f,  0.5f, -0.5f,  1.0f, 1.0f,   1.0f,  0.0f,  0.0f,
+         0.5f, -0.5f, -0.5f,  0.0f, 1.0f,   1.0f,  0.0f,  0.0f,
+         0.5f, -0.5f, -0.5f,  0.0f, 1.0f,   1.0f,  0.0f,  0.0f,
+         0.5f, -0.5f,  0.5f,  0.0f, 0.0f,   1.0f,  0.0f,  0.0f,
+         0.5f,  0.5f,  0.5f,  1.0f, 0.0f,   1.0f,  0.0f,  0.0f,
+
+        // Bottom face
+        -0.5f, -0.5f, -0.5f,  0.0f, 1.0f,   0.0f, -1.0f,  0.0f,
+         0.5f, -0.5f, -0.5f,  1.0f, 1.0f,   0.0f, -1.0f,  0.0f,
+         0.5f, -0.5f,  0.5f,  1.0f, 0.0f,   0.0f, -1.0f,  0.0f,
+         0.5f, -0.5f,  0.5f,  1.0f, 0.0f,   0.0f, -1.0f,  0.0f,
+        -0.5f, -0.5f,  0.5f,  0.0f, 0.0f,   0.0f, -1.0f,  0.0f,
+        -0.5f, -0.5f, -0.5f,  0.0f, 1.0f,   0.0f, -1.0f,  0.0f,
+
+        // Top face
+        -0.5f,  0.5f, -0.5f,  0.0f, 1.0f,   0.0f,  1.0f,  0.0f,
+         0.5f,  0.5f, -0.5f,  1.0f, 1.0f,   0.0f,  1.0f,  0.0f,
+         0.5f,  0.5f,  0.5f,  1.0f, 0.0f,   0.0f,  1.0f,  0.0f,
+         0.5f,  0.5f,  0.5f,  1.0f, 0.0f,   0.0f,  1.0f,  0.0f,
+        -0.5f,  0.5f,  0.5f,  0.0f, 0.0f,   0.0f,  1.0f,  0.0f,
+        -0.5f,  0.5f, -0.5f,  0.0f, 1.0f,   0.0f,  1.0f,  0.0f
+    };
+
+    static glm::vec3 position(int ix){
+        return glm::vec3(vertices[ix * STRIDE], vertices[ix * STRIDE + 1], vertices[ix * STRIDE + 2]);
+    }
+
+    // first vertex of a face, and of the front face the quad drawn for every face
+    static constexpr int firstVertex(int face){ return 6 * face; }
+    static constexpr int FRONT = 1;
+
+    /*
+     * Linear map taking the front face quad onto a face, texture coordinates
+     * included: x & y go along the face's u & v directions, z along its normal.
+     * Faces drawn as front quads through it look exactly like the mesh faces.
+     */
+    static glm::mat4 faceFrame(int face){
+        glm::vec3 origin, u, v;
+        for(int ix = firstVertex(face); ix != firstVertex(face) + 6; ++ix){
+            float s = vertices[ix * STRIDE + 3], t = vertices[ix * STRIDE + 4];
+            if(s == 0 && t == 0) origin = position(ix);
+            if(s == 1 && t == 0) u = position(ix);
+            if(s == 0 && t == 1) v = position(ix);
+        }
+        const float* n = &vertices[firstVertex(face) * STRIDE + 5];
+        return glm::mat4(glm::vec4(u - origin, 0), glm::vec4(v - origin, 0), glm::vec4(n[0], n[1], n[2], 0),
+                         glm::vec4(0, 0, 0, 1.0f));
+    }
+};
+
+#endif
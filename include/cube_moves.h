@@ -0,0 +1,427 @@
+#ifndef CUBE_MOVES_H_
+#define CUBE_MOVES_H_
+
+#include <algorithm>
+#include <cctype>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <utility>
+#include <string>
+#include <vector>
+
+#include "cube_state.h"
+
+/*
+ * This file contains the GL-free move layer on top of CubeState:
+ * moves, parsing & printing of move notation, scrambling and verification.
+ */
+
+/*
+ * A turn of one layer (or of the whole cube) by some quarter turns,
+ * counter-clockwise looking down the axis, the same convention as CubeState::turn.
+ */
+struct Move {
+    RotateState axis;
+    int layer;
+    int quarters;
+
+    Move(): axis(ROTATE_NONE), layer(LAYER_NONE), quarters(0) {}
+    Move(RotateState axis_, int layer_, int quarters_):
+        axis(axis_), layer(layer_), quarters(quarters_) {}
+
+    bool operator==(const Move& other) const {
+        return axis == other.axis && layer == other.layer &&
+               ((quarters - other.quarters) % 4 + 4) % 4 == 0;
+    }
+};
+
+/*
+ * Face letters of standard notation. For each face: the axis it turns
+ * around, whether it sits on the positive side of that axis and the
+ * direction of a clockwise turn seen from the face, in CubeState quarters.
+ */
+struct NotationFace {
+    char letter;
+    RotateState axis;
+    bool positive;
+    int clockwise;
+};
+
+const NotationFace NOTATION_FACES[6] = {
+    {'R', ROTATE_X, true,  -1}, {'L', ROTATE_X, false, 1},
+    {'U', ROTATE_Y, true,  -1}, {'D', ROTATE_Y, false, 1},
+    {'F', ROTATE_Z, true,  -1}, {'B', ROTATE_Z, false, 1}
+};
+
+/*
+ * Layer index of the n-th layer (1-based) counted from a face.
+ * z layers grow from the front face, x & y layers from the left & bottom faces.
+ */
+inline int faceLayer(const NotationFace& face, int n, int rank){
+    bool from_high_index = face.axis == ROTATE_Z ? !face.positive : face.positive;
+    return from_high_index ? rank - n : n - 1;
+}
+
+inline void applyMove(CubeState& state, const Move& move){
+    state.turn(move.axis, move.layer, move.quarters);
+}
+
+inline void applyMoves(CubeState& state, const std::vector<Move>& moves){
+    for(const Move& move : moves) applyMove(state, move);
+}
+
+/*
+ * Parse a token of WCA / SiGN notation into the layer turns it stands for:
+ *
+ *   R, U', F2       outer layer
+ *   3R              3rd layer counted from the face
+ *   Rw, r           outer two layers, 3Rw & 3r the outer three
+ *   2-3Rw, 2-3r     layers 2 to 3 counted from the face
+ *   M, E, S         every inner layer, turning like L, D & F
+ *   x, y, z         whole cube
+ *
+ * @return false if the token is not a valid move for this rank, moves is then unchanged
+ */
+inline bool parseToken(const std::string& token, int rank, std::vector<Move>& moves){
+    size_t pos = 0;
+    int numbers[2] = {0, 0}, count = 0;
+    while(count != 2 && pos < token.size() && std::isdigit(static_cast<unsigned char>(token[pos]))){
+        while(pos < token.size() && std::isdigit(static_cast<unsigned char>(token[pos])))
+            numbers[count] = std::min(numbers[count] * 10 + (token[pos++] - '0'), rank + 1);
+        // a second number after a dash closes a range of layers
+        if(++count == 1 && pos < token.size() && token[pos] == '-') ++pos;
+        else break;
+    }
+    if(pos >= token.size() || (pos > 0 && token[pos - 1] == '-')) return false;
+
+    char letter = token[pos++];
+    bool wide = false;
+    if(pos < token.size() && token[pos] == 'w'){
+        if(!std::isupper(static_cast<unsigned char>(letter))) return false;
+        wide = true;
+        ++pos;
+    }
+
+    int amount = 1;
+    if(pos < token.size() && token[pos] == '2'){
+        amount = 2;
+        ++pos;
+    }
+    if(pos < token.size() && token[pos] == '\''){
+        amount = -amount;
+        ++pos;
+    }
+    if(pos != token.size()) return false;
+
+    // the face the turn is seen from and its layers, counted from that face
+    const NotationFace* face = nullptr;
+    int first = 1, last = 1;
+    if(letter == 'x' || letter == 'y' || letter == 'z'){
+        if(count != 0 || wide) return false;
+        face = &NOTATION_FACES[2 * (letter - 'x')];
+        last = rank;
+    }
+    else if(letter == 'M' || letter == 'E' || letter == 'S'){
+        if(count != 0 || wide || rank < 3) return false;
+        face = &NOTATION_FACES[letter == 'M' ? 1 : letter == 'E' ? 3 : 4];
+        first = 2;
+        last = rank - 1;
+    }
+    else{
+        for(const NotationFace& f : NOTATION_FACES)
+            if(f.letter == std::toupper(static_cast<unsigned char>(letter))) face = &f;
+        if(!face) return false;
+        wide = wide || std::islower(static_cast<unsigned char>(letter));
+        if(count == 2){
+            first = numbers[0];
+            last = numbers[1];
+        }
+        else if(wide){
+            last = count == 1 ? numbers[0] : 2;
+        }
+        else if(count == 1){
+            first = last = numbers[0];
+        }
+        if(first < 1 || first > last || last > rank) return false;
+    }
+
+    int quarters = face->clockwise * amount;
+    if(first == 1 && last == rank){
+        moves.emplace_back(face->axis, LAYER_ALL, quarters);
+        return true;
+    }
+    for(int n = first; n <= last; ++n)
+        moves.emplace_back(face->axis, faceLayer(*face, n, rank), quarters);
+    return true;
+}
+
+/*
+ * Parse a token standing for a single layer turn (or whole cube rotation),
+ * e.g. "R", "U'", "F2", "3L'" or "x".
+ *
+ * @return false if the token is not a valid move for this rank
+ */
+inline bool parseMove(const std::string& token, int rank, Move& move){
+    std::vector<Move> moves;
+    if(!parseToken(token, rank, moves) || moves.size() != 1) return false;
+    move = moves[0];
+    return true;
+}
+
+/*
+ * Parse a whitespace separated move sequence.
+ * Invalid tokens are reported on std::cerr.
+ *
+ * @return false if any token is invalid, moves then holds the valid prefix
+ */
+inline bool parseMoves(const std::string& text, int rank, std::vector<Move>& moves){
+    std::istringstream in(text);
+    std::string token;
+    while(in >> token){
+        if(!parseToken(token, rank, moves)){
+            std::cerr << "Invalid move \"" << token << "\" for a rank " << rank << " cube." << std::endl;
+            return false;
+        }
+    }
+    return true;
+}
+
+/*
+ * Print a move in standard notation. Inner layers are numbered from the
+ * nearest face on the positive side of the axis, e.g. "2R" on a 4x4x4.
+ * Moves of layers outside the cube print as "".
+ */
+inline std::string formatMove(const Move& move, int rank){
+    int quarters = ((move.quarters % 4) + 4) % 4;
+    if(move.axis == ROTATE_NONE || quarters == 0) return "";
+
+    std::string text;
+    const NotationFace* face = nullptr;
+    if(move.layer == LAYER_ALL){
+        face = &NOTATION_FACES[2 * move.axis];
+        text += static_cast<char>('x' + move.axis);
+    }
+    else{
+        // prefer the face the layer is closest to
+        const NotationFace& positive = NOTATION_FACES[2 * move.axis];
+        const NotationFace& negative = NOTATION_FACES[2 * move.axis + 1];
+        int n = 1;
+        while(n <= rank && faceLayer(positive, n, rank) != move.layer && faceLayer(negative, n, rank) != move.layer) ++n;
+        if(n > rank) return "";
+        face = faceLayer(positive, n, rank) == move.layer ? &positive : &negative;
+        if(n > 1) text += std::to_string(n);
+        text += face->letter;
+    }
+
+    // quarters are counter-clockwise, clockwise is -1 for the positive face
+    int clockwise_turns = ((quarters * face->clockwise) % 4 + 4) % 4;
+    if(clockwise_turns == 2) text += '2';
+    if(clockwise_turns == 3) text += '\'';
+    return text;
+}
+
+inline std::string formatMoves(const std::vector<Move>& moves, int rank){
+    std::string text;
+    for(const Move& move : moves){
+        std::string token = formatMove(move, rank);
+        if(token.empty()) continue;
+        if(!text.empty()) text += ' ';
+        text += token;
+    }
+    return text;
+}
+
+/*
+ * Canonical form of a move sequence, built one move at a time.
+ *
+ * Turns around the same axis commute, so a run of them is kept as the
+ * net number of quarters per layer: repeated turns merge (U U U = U'),
+ * inverse pairs cancel (R R' = nothing) and opposite faces fall into a
+ * fixed order. A run that cancels out exposes the run before it, so
+ * R U U' R' cancels entirely. Runs are written out as a whole cube
+ * rotation when that takes fewer moves (R M' L' = x), then layers by
+ * index; amounts are 1, 2 or -1 quarters.
+ */
+class MoveSimplifier {
+public:
+    MoveSimplifier(int rank_ = 3): rank(rank_) {}
+
+    void push(const Move& move){
+        int quarters = ((move.quarters % 4) + 4) % 4;
+        if(move.axis == ROTATE_NONE || move.layer == LAYER_NONE || quarters == 0) return;
+        if(runs.empty() || runs.back().axis != move.axis) runs.push_back(Run{move.axis, 0, {}});
+
+        Run& run = runs.back();
+        if(move.layer == LAYER_ALL) run.all = (run.all + quarters) % 4;
+        else{
+            std::vector<std::pair<int, int>>::iterator it = run.layers.begin();
+            while(it != run.layers.end() && it->first < move.layer) ++it;
+            if(it == run.layers.end() || it->first != move.layer) it = run.layers.insert(it, std::make_pair(move.layer, 0));
+            it->second = (it->second + quarters) % 4;
+            if(it->second == 0) run.layers.erase(it);
+        }
+        // every layer turned by the same amount is a rotation
+        if(static_cast<int>(run.layers.size()) == rank){
+            int q = run.layers[0].second;
+            bool same = true;
+            for(const std::pair<int, int>& layer : run.layers) same = same && layer.second == q;
+            if(same){
+                run.all = (run.all + q) % 4;
+                run.layers.clear();
+            }
+        }
+        if(run.all == 0 && run.layers.empty()) runs.pop_back();
+    }
+
+    void push(const std::vector<Move>& moves){
+        for(const Move& move : moves) push(move);
+    }
+
+    void clear(){ runs.clear(); }
+
+    std::vector<Move> moves() const {
+        std::vector<Move> result;
+        for(const Run& run : runs) write(run, result);
+        return result;
+    }
+
+private:
+    struct Run {
+        RotateState axis;
+        int all;                                  // quarters of the whole cube
+        std::vector<std::pair<int, int>> layers;  // (layer, quarters) on top of all, by layer
+    };
+
+    int rank;
+    std::vector<Run> runs;
+
+    static int amount(int quarters){
+        quarters = ((quarters % 4) + 4) % 4;
+        return quarters == 3 ? -1 : quarters;
+    }
+
+    // net turn of every layer is all + its own quarters, pick the rotation leaving the fewest layer turns
+    void write(const Run& run, std::vector<Move>& result) const {
+        int count[4] = {0, 0, 0, 0};
+        count[run.all] = rank - static_cast<int>(run.layers.size());
+        for(const std::pair<int, int>& layer : run.layers) ++count[(run.all + layer.second) % 4];
+
+        int best = 0;
+        for(int q = 1; q != 4; ++q)
+            if(1 + rank - count[q] < (best == 0 ? 0 : 1) + rank - count[best]) best = q;
+
+        if(best != 0) result.emplace_back(run.axis, LAYER_ALL, amount(best));
+        if(run.all == best){
+            for(const std::pair<int, int>& layer : run.layers) result.emplace_back(run.axis, layer.first, amount(layer.second));
+            return;
+        }
+        // the rotation of the run changed, which touches every layer
+        std::vector<std::pair<int, int>>::const_iterator it = run.layers.begin();
+        for(int layer = 0; layer != rank; ++layer){
+            int q = run.all;
+            if(it != run.layers.end() && it->first == layer) q += (it++)->second;
+            if((q - best) % 4 != 0) result.emplace_back(run.axis, layer, amount(q - best));
+        }
+    }
+};
+
+/*
+ * Merge & cancel redundant turns of a move sequence, see MoveSimplifier.
+ */
+inline std::vector<Move> simplifyMoves(const std::vector<Move>& moves, int rank){
+    MoveSimplifier simplifier(rank);
+    simplifier.push(moves);
+    return simplifier.moves();
+}
+
+/*
+ * Random scramble of single layer turns. Consecutive moves never share
+ * an axis, so no move cancels or merges with the previous one.
+ */
+inline std::vector<Move> scramble(int rank, int length, std::mt19937& rng){
+    std::vector<Move> moves;
+    std::uniform_int_distribution<int> axis_dist(0, 2), layer_dist(0, rank - 1), quarter_dist(1, 3);
+    int last_axis = -1;
+    while(static_cast<int>(moves.size()) < length){
+        int axis = axis_dist(rng);
+        if(axis == last_axis) continue;
+        moves.emplace_back(RotateState(axis), layer_dist(rng), quarter_dist(rng));
+        last_axis = axis;
+    }
+    return moves;
+}
+
+/*
+ * Check that a move sequence solves a state.
+ */
+inline bool verifySolution(CubeState state, const std::vector<Move>& moves){
+    applyMoves(state, moves);
+    return state.solved();
+}
+
+/*
+ * A move sequence compiled into a single permutation of the facelets.
+ *
+ * Compiling costs about as much as turning the moves once; applying the
+ * result is one pass over the facelets however long the sequence, e.g.
+ * to replay a 10,000 move algorithm or the same scramble on many states.
+ */
+class CompiledMoves {
+public:
+    CompiledMoves(int rank_ = 3): geometry(rank_) {
+        from.resize(geometry.numFacelets());
+        for(int ix = 0; ix != geometry.numFacelets(); ++ix) from[ix] = ix;
+    }
+
+    CompiledMoves(int rank_, const std::vector<Move>& moves): CompiledMoves(rank_) {
+        append(moves);
+    }
+
+    int getRank() const { return geometry.getRank(); }
+
+    /*
+     * Add a move to the end of the sequence.
+     */
+    void append(const Move& move){
+        moved.clear();
+        geometry.turnedFacelets(move.axis, move.layer, move.quarters, moved);
+        scratch.resize(moved.size() / 2);
+        for(std::size_t k = 0; k != scratch.size(); ++k) scratch[k] = from[moved[2 * k]];
+        for(std::size_t k = 0; k != scratch.size(); ++k) from[moved[2 * k + 1]] = scratch[k];
+    }
+
+    void append(const std::vector<Move>& moves){
+        for(const Move& move : moves) append(move);
+    }
+
+    /*
+     * Add a compiled sequence of the same rank to the end of this one.
+     *
+     * @return false, leaving this sequence unchanged, if the ranks differ
+     */
+    bool append(const CompiledMoves& next){
+        if(next.getRank() != getRank()) return false;
+        scratch = from;
+        for(std::size_t ix = 0; ix != from.size(); ++ix) from[ix] = scratch[next.from[ix]];
+        return true;
+    }
+
+    /*
+     * Apply the whole sequence to a state in one pass.
+     *
+     * @return false if the state is of another rank
+     */
+    bool apply(CubeState& state) const {
+        if(state.getRank() != getRank()) return false;
+        state.permute(from);
+        return true;
+    }
+
+private:
+    CubeState geometry;      // solved state of the rank, for the facelet layout
+    std::vector<int> from;   // facelet ix of the result comes from from[ix]
+    std::vector<int> moved, scratch;
+};
+
+#endif
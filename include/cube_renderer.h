@@ -0,0 +1,294 @@
+#ifndef CUBE_RENDERER_H_
+#define CUBE_RENDERER_H_
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/type_ptr.hpp>
+
+#include <algorithm>
+#include <cstddef>
+#include <vector>
+
+#include "cube_mesh.h"
+#include "gl_resources.h"
+#include "texture_pack.h"
+
+/*
+ * Per-instance data of one visible face, laid out exactly as uploaded to the
+ * instance buffer: the model matrix placing the front face quad, its texture
+ * layer and the grid position (col, layer, row) the shader picks turning
+ * layers by.
+ */
+struct FaceInstance {
+    glm::mat4 model;
+    GLubyte texture;
+    GLubyte grid[3];
+};
+
+/*
+ * A corner of a face in the merged mesh, already placed in the world.
+ * Textures change with every move and are kept in a stream of their own.
+ */
+struct MergedVertex {
+    glm::vec3 position;
+    glm::vec2 texCoords;
+    glm::vec3 normal;
+    GLubyte grid[3];
+    GLubyte padding;
+};
+
+/*
+ * MESH_INSTANCED draws the front face quad once per face instance,
+ * MESH_MERGED draws one vertex buffer holding every face, for drivers
+ * where instanced attributes are slow.
+ */
+enum MeshMode {MESH_INSTANCED, MESH_MERGED};
+
+/*
+ * Per-frame uniforms, matching the std140 layout of the FrameData block
+ * declared in the vertex & fragment shaders. Each vec3 occupies 16 bytes,
+ * except the last one, whose padding holds the scalar after it.
+ */
+struct FrameUniforms {
+    glm::mat4 view;
+    glm::mat4 perspective;
+    glm::vec4 cameraPos;
+    glm::vec4 lightPos;
+    glm::vec4 light_ambient;
+    glm::vec3 light_diffuse;
+    GLint proceduralStickers = 0;  // a bool packed after the last vec3, as std140 does
+};
+
+const GLuint FRAME_UNIFORMS_BINDING = 0;
+
+/*
+ * Draws the visible faces of a magic cube with a single instanced draw call.
+ * The shared unit cube mesh is uploaded once and its front face drawn for
+ * every instance; model matrices and face textures are uploaded per instance
+ * when they change, and face textures live in one texture array. A turning
+ * layer is rotated in the vertex shader.
+ *
+ * In MESH_MERGED mode the faces are expanded into one persistent vertex
+ * buffer instead, drawn with a plain indexed draw call; only the texture
+ * stream is uploaded again when a move commits.
+ */
+class CubeRenderer {
+public:
+    /*
+     * Upload baked face textures into the layers of a single texture array.
+     * Every mipmap level comes from the pack, nothing is decoded or generated.
+     *
+     * @param pack: baked textures, may be closed once uploaded
+     */
+    void loadTextures(const TexturePack& pack){
+        texture_array = resources.genTexture();
+        glBindTexture(GL_TEXTURE_2D_ARRAY, texture_array);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_REPEAT);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_REPEAT);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_BASE_LEVEL, 0);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAX_LEVEL, pack.getLevels() - 1);
+
+        // rows of the smaller levels are not 4-byte aligned
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+        for(int level = 0; level != pack.getLevels(); ++level){
+            glTexImage3D(GL_TEXTURE_2D_ARRAY, level, GL_RGBA8, pack.levelSize(level), pack.levelSize(level),
+                         pack.getLayers(), 0, GL_RGBA, GL_UNSIGNED_BYTE, pack.levelData(level));
+        }
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    }
+
+    /*
+     * Replace the instances drawn by draw, e.g. after a move is committed.
+     * Frames in between, animated ones included, upload nothing.
+     *
+     * @param instances: model matrix, texture & grid position of each face
+     * @param geometry: false if only textures changed since the last upload
+     */
+    void upload(const std::vector<FaceInstance>& instances, bool geometry = true){
+        if(first_draw) initDrawing();
+        instance_count = instances.size();
+        if(mode == MESH_MERGED){
+            uploadMerged(instances, geometry);
+            return;
+        }
+
+        // orphan the previous buffer so the driver need not wait for the last frame;
+        // the size only changes when the buffer grows, so the driver can recycle its storage
+        glBindBuffer(GL_ARRAY_BUFFER, instanceVBO);
+        if(instances.size() > instance_capacity)
+            instance_capacity = std::max(instances.size(), 2 * instance_capacity);
+        glBufferData(GL_ARRAY_BUFFER, instance_capacity * sizeof(FaceInstance), NULL, GL_DYNAMIC_DRAW);
+        glBufferSubData(GL_ARRAY_BUFFER, 0, instances.size() * sizeof(FaceInstance), instances.data());
+    }
+
+    /*
+     * Draw the uploaded faces with one draw call: instanced, or as indexed
+     * vertices of the merged mesh.
+     * Call loadTextures & upload before calling this method.
+     */
+    void draw(){
+        if(first_draw) initDrawing();
+        glBindVertexArray(mode == MESH_MERGED ? mergedVAO : VAO);
+        // procedural stickers never sample the texture array
+        if(textured) glBindTexture(GL_TEXTURE_2D_ARRAY, texture_array);
+        if(mode == MESH_MERGED){
+            // vertices are placed already, the model attribute is a constant identity
+            for(int col = 0; col != 4; ++col){
+                glm::vec4 column(0.0f);
+                column[col] = 1.0f;
+                glVertexAttrib4fv(3 + col, glm::value_ptr(column));
+            }
+            glDrawElements(GL_TRIANGLES, 6 * instance_count, GL_UNSIGNED_INT, (void*)0);
+        }
+        else
+            glDrawArraysInstanced(GL_TRIANGLES, CubeMesh::firstVertex(CubeMesh::FRONT), 6, instance_count);
+        glBindVertexArray(0);
+    }
+
+    /*
+     * Switch between instanced & merged drawing.
+     * Call upload with the geometry again before the next draw.
+     */
+    void setMeshMode(MeshMode mode_){ mode = mode_; }
+    MeshMode getMeshMode() const { return mode; }
+
+    /*
+     * Whether draw binds the texture array, turn off for procedural stickers.
+     */
+    void setTextured(bool textured_){ textured = textured_; }
+
+    /*
+     * Release every GPU object of the renderer.
+     * Must be called before the GL context is destroyed.
+     */
+    void finishDrawing(){
+        resources.release();
+        texture_array = 0;
+        instance_capacity = 0;
+        instance_count = 0;
+        index_capacity = 0;
+        first_draw = true;
+    }
+
+private:
+    GLResources resources;
+    GLuint VAO, meshVBO, instanceVBO;
+    GLuint mergedVAO, mergedVBO, mergedTextureVBO, mergedEBO;
+    GLuint texture_array = 0;
+    std::size_t instance_capacity = 0;   // in instances
+    std::size_t instance_count = 0;
+    std::size_t index_capacity = 0;      // in faces
+    MeshMode mode = MESH_INSTANCED;
+    bool textured = true;
+    bool first_draw = true;
+    std::vector<MergedVertex> merged_vertices;
+    std::vector<GLubyte> merged_textures;
+
+    /*
+     * Expand the faces into the merged mesh, four corners each.
+     * The geometry is rebuilt only when asked, the texture stream every time.
+     */
+    void uploadMerged(const std::vector<FaceInstance>& instances, bool geometry){
+        // corners of the front face quad, in the order the mesh draws its triangles
+        static const glm::vec2 corners[4] = {glm::vec2(0, 0), glm::vec2(1.0f, 0), glm::vec2(1.0f, 1.0f), glm::vec2(0, 1.0f)};
+
+        glBindVertexArray(mergedVAO);
+        if(geometry){
+            merged_vertices.resize(4 * instances.size());
+            for(std::size_t ix = 0; ix != instances.size(); ++ix){
+                const FaceInstance& face = instances[ix];
+                glm::vec3 normal = glm::normalize(glm::mat3(face.model) * glm::vec3(0, 0, 1.0f));
+                for(int c = 0; c != 4; ++c){
+                    MergedVertex& v = merged_vertices[4 * ix + c];
+                    v.position = glm::vec3(face.model * glm::vec4(corners[c] - 0.5f, 0.5f, 1.0f));
+                    v.texCoords = corners[c];
+                    v.normal = normal;
+                    std::copy(face.grid, face.grid + 3, v.grid);
+                    v.padding = 0;
+                }
+            }
+            glBindBuffer(GL_ARRAY_BUFFER, mergedVBO);
+            glBufferData(GL_ARRAY_BUFFER, merged_vertices.size() * sizeof(MergedVertex), merged_vertices.data(), GL_STATIC_DRAW);
+        }
+
+        if(instances.size() > index_capacity){
+            index_capacity = std::max(instances.size(), 2 * index_capacity);
+            std::vector<GLuint> indices(6 * index_capacity);
+            for(std::size_t ix = 0; ix != index_capacity; ++ix){
+                static const GLuint quad[6] = {0, 1, 2, 2, 3, 0};
+                for(int k = 0; k != 6; ++k) indices[6 * ix + k] = 4 * ix + quad[k];
+            }
+            glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(GLuint), indices.data(), GL_STATIC_DRAW);
+        }
+
+        merged_textures.resize(4 * instances.size());
+        for(std::size_t ix = 0; ix != instances.size(); ++ix)
+            std::fill_n(merged_textures.begin() + 4 * ix, 4, instances[ix].texture);
+        glBindBuffer(GL_ARRAY_BUFFER, mergedTextureVBO);
+        glBufferData(GL_ARRAY_BUFFER, merged_textures.size(), merged_textures.data(), GL_DYNAMIC_DRAW);
+        glBindVertexArray(0);
+    }
+
+    /*
+     * initialize VAO & VBOs when drawing for the first time
+     */
+    void initDrawing(){
+        const GLsizei stride = CubeMesh::STRIDE * sizeof(GLfloat);
+        VAO = resources.genVertexArray();
+        glBindVertexArray(VAO);
+
+        meshVBO = resources.genBuffer();
+        glBindBuffer(GL_ARRAY_BUFFER, meshVBO);
+        glBufferData(GL_ARRAY_BUFFER, sizeof(CubeMesh::vertices), CubeMesh::vertices, GL_STATIC_DRAW);
+        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, stride, (void*)0);
+        glEnableVertexAttribArray(0);
+        glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, stride, (void*)(3*sizeof(GLfloat)));
+        glEnableVertexAttribArray(1);
+        glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, stride, (void*)(5*sizeof(GLfloat)));
+        glEnableVertexAttribArray(2);
+
+        instanceVBO = resources.genBuffer();
+        glBindBuffer(GL_ARRAY_BUFFER, instanceVBO);
+        // a mat4 attribute takes 4 consecutive locations, one per column
+        for(int col = 0; col != 4; ++col){
+            glVertexAttribPointer(3 + col, 4, GL_FLOAT, GL_FALSE, sizeof(FaceInstance), 
+                                  (void*)(offsetof(FaceInstance, model) + col * sizeof(glm::vec4)));
+            glEnableVertexAttribArray(3 + col);
+            glVertexAttribDivisor(3 + col, 1);
+        }
+        glVertexAttribIPointer(7, 1, GL_UNSIGNED_BYTE, sizeof(FaceInstance), (void*)offsetof(FaceInstance, texture));
+        glEnableVertexAttribArray(7);
+        glVertexAttribDivisor(7, 1);
+        glVertexAttribIPointer(8, 3, GL_UNSIGNED_BYTE, sizeof(FaceInstance), (void*)offsetof(FaceInstance, grid));
+        glEnableVertexAttribArray(8);
+        glVertexAttribDivisor(8, 1);
+
+        // merged mesh: the same attributes, every one of them per vertex
+        mergedVAO = resources.genVertexArray();
+        glBindVertexArray(mergedVAO);
+        mergedVBO = resources.genBuffer();
+        glBindBuffer(GL_ARRAY_BUFFER, mergedVBO);
+        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(MergedVertex), (void*)offsetof(MergedVertex, position));
+        glEnableVertexAttribArray(0);
+        glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, sizeof(MergedVertex), (void*)offsetof(MergedVertex, texCoords));
+        glEnableVertexAttribArray(1);
+        glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, sizeof(MergedVertex), (void*)offsetof(MergedVertex, normal));
+        glEnableVertexAttribArray(2);
+        glVertexAttribIPointer(8, 3, GL_UNSIGNED_BYTE, sizeof(MergedVertex), (void*)offsetof(MergedVertex, grid));
+        glEnableVertexAttribArray(8);
+        mergedTextureVBO = resources.genBuffer();
+        glBindBuffer(GL_ARRAY_BUFFER, mergedTextureVBO);
+        glVertexAttribIPointer(7, 1, GL_UNSIGNED_BYTE, 0, (void*)0);
+        glEnableVertexAttribArray(7);
+        mergedEBO = resources.genBuffer();
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, mergedEBO);
+
+        glBindVertexArray(0);
+        first_draw = false;
+    }
+};
+
+#endif
@@ -0,0 +1,274 @@
+#ifndef CUBE_STATE_H_
+#define CUBE_STATE_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+enum RotateState {ROTATE_X, ROTATE_Y, ROTATE_Z, ROTATE_NONE};
+enum Face {FACE_BACK, FACE_FRONT, FACE_LEFT, FACE_RIGHT, FACE_BUTTOM, FACE_TOP};
+enum FaceTexture { FACE_TEXTURE_0, FACE_TEXTURE_1, FACE_TEXTURE_2, FACE_TEXTURE_3, FACE_TEXTURE_4, FACE_TEXTURE_5, FACE_TEXTURE_6 };
+
+// Layers are addressed by index along an axis, these stand for no / every layer
+const int LAYER_ALL  = -1;
+const int LAYER_NONE = -2;
+
+/*
+ * Logical state of a magic cube, one byte per facelet.
+ *
+ * Facelets are stored face by face, each face being a rank x rank grid.
+ * A facelet (f, i, j) sits on the cubie at grid position (x, y, z), where
+ * x is the column (growing to the right), y is the layer (growing upwards)
+ * and z is the row (growing from the front face to the back face):
+ *
+ *     FACE_BACK / FACE_FRONT:  z = rank-1 / 0,  y = i, x = j
+ *     FACE_LEFT / FACE_RIGHT:  x = 0 / rank-1,  y = i, z = j
+ *     FACE_BUTTOM / FACE_TOP:  y = 0 / rank-1,  z = i, x = j
+ *
+ * A layer of axis ROTATE_X, ROTATE_Y or ROTATE_Z is indexed by x, y or z.
+ */
+class CubeState {
+public:
+    CubeState(): CubeState(3) {}
+    CubeState(int rank_) { reset(rank_); }
+
+    /*
+     * Reset to the solved state of the given rank.
+     */
+    void reset(int rank_){
+        rank = rank_;
+        facelets.resize(6 * rank * rank);
+        for(int f = 0; f != 6; ++f){
+            for(int ix = 0; ix != rank * rank; ++ix)
+                facelets[f * rank * rank + ix] = solvedTexture(Face(f));
+        }
+    }
+
+    int getRank() const { return rank; }
+
+    FaceTexture facelet(Face f, int i, int j) const {
+        return FaceTexture(facelets[index(f, i, j)]);
+    }
+
+    /*
+     * Facelets are also addressed by their index, (f * rank + i) * rank + j.
+     */
+    int numFacelets() const { return static_cast<int>(facelets.size()); }
+    FaceTexture facelet(int ix) const { return FaceTexture(facelets[ix]); }
+    void setFacelet(int ix, FaceTexture t){ facelets[ix] = t; }
+
+    int faceletIndex(Face f, int i, int j) const { return index(f, i, j); }
+
+    /*
+     * Index of face f of the cubie at grid position g, which has to lie on that face.
+     */
+    int faceletIndex(Face f, const int* g) const { return gridIndex(f, g); }
+
+    /*
+     * Face and cubie grid position of the facelet at index ix.
+     */
+    void faceletGrid(int ix, Face& f, int* g) const {
+        f = Face(ix / (rank * rank));
+        toGrid(f, ix / rank % rank, ix % rank, g);
+    }
+
+    /*
+     * Texture of face f of the cubie at grid position (x, y, z).
+     * Faces hidden inside the cube are blank (FACE_TEXTURE_0).
+     */
+    FaceTexture cubieFace(int x, int y, int z, Face f) const {
+        switch(f){
+            case FACE_BACK:   return z == rank-1 ? facelet(f, y, x) : FACE_TEXTURE_0;
+            case FACE_FRONT:  return z == 0      ? facelet(f, y, x) : FACE_TEXTURE_0;
+            case FACE_LEFT:   return x == 0      ? facelet(f, y, z) : FACE_TEXTURE_0;
+            case FACE_RIGHT:  return x == rank-1 ? facelet(f, y, z) : FACE_TEXTURE_0;
+            case FACE_BUTTOM: return y == 0      ? facelet(f, z, x) : FACE_TEXTURE_0;
+            case FACE_TOP:    return y == rank-1 ? facelet(f, z, x) : FACE_TEXTURE_0;
+        }
+        return FACE_TEXTURE_0;
+    }
+
+    /*
+     * Set the texture of face f of the cubie at grid position (x, y, z),
+     * which has to lie on that face.
+     */
+    void setCubieFace(int x, int y, int z, Face f, FaceTexture t){
+        int g[3] = {x, y, z};
+        facelets[gridIndex(f, g)] = t;
+    }
+
+    /*
+     * Turn one layer (or the whole cube) around an axis.
+     * A positive quarter turn is counter-clockwise looking down the axis,
+     * the same direction glm::rotate uses for a positive angle.
+     * Only facelets on the layer are visited, O(rank) for an inner layer.
+     *
+     * @param axis: rotation axis
+     * @param layer: layer index along the axis, or LAYER_ALL for the whole cube
+     * @param quarters: number of quarter turns, may be negative
+     */
+    void turn(RotateState axis, int layer, int quarters){
+        moved.clear();
+        turnedFacelets(axis, layer, quarters, moved);
+        scratch.resize(moved.size() / 2);
+        for(std::size_t k = 0; k != scratch.size(); ++k) scratch[k] = facelets[moved[2 * k]];
+        for(std::size_t k = 0; k != scratch.size(); ++k) facelets[moved[2 * k + 1]] = scratch[k];
+    }
+
+    /*
+     * Facelets moved by a turn, appended to moved as (from, to) index pairs.
+     * Only facelets on the layer are listed, O(rank) for an inner layer.
+     */
+    void turnedFacelets(RotateState axis, int layer, int quarters, std::vector<int>& moved) const {
+        quarters = ((quarters % 4) + 4) % 4;
+        if(axis == ROTATE_NONE || layer == LAYER_NONE || quarters == 0) return;
+
+        const int c = COS[quarters], s = SIN[quarters];
+        int g[3];
+        for(int f = 0; f != 6; ++f){
+            bool whole_face = layer == LAYER_ALL ||
+                (NORMALS[f][axis] != 0 && layer == (NORMALS[f][axis] > 0 ? outer(axis) : inner(axis)));
+            // other faces parallel to the axis are cut by the layer along a line
+            if(!whole_face && NORMALS[f][axis] != 0) continue;
+            for(int t = 0; t != (whole_face ? rank * rank : rank); ++t){
+                int i = whole_face ? t / rank : (I_AXIS[f] == axis ? layer : t);
+                int j = whole_face ? t % rank : (I_AXIS[f] == axis ? t : layer);
+                toGrid(Face(f), i, j, g);
+                moved.push_back(index(Face(f), i, j));
+                moved.push_back(turned(Face(f), g, axis, c, s));
+            }
+        }
+    }
+
+    /*
+     * Move every facelet at once: index ix takes the texture found at
+     * index from[ix], see CompiledMoves.
+     */
+    void permute(const std::vector<int>& from){
+        scratch.assign(facelets.begin(), facelets.end());
+        for(std::size_t ix = 0; ix != facelets.size(); ++ix) facelets[ix] = scratch[from[ix]];
+    }
+
+    /*
+     * Index the facelet at index ix moves to when turning a layer.
+     * Facelets off the layer stay where they are.
+     */
+    int turnedFacelet(int ix, RotateState axis, int layer, int quarters) const {
+        quarters = ((quarters % 4) + 4) % 4;
+        if(axis == ROTATE_NONE || layer == LAYER_NONE || quarters == 0) return ix;
+        Face f;
+        int g[3];
+        faceletGrid(ix, f, g);
+        if(layer != LAYER_ALL && g[axis] != layer) return ix;
+        return turned(f, g, axis, COS[quarters], SIN[quarters]);
+    }
+
+    /*
+     * The cube is solved when every face shows a single texture.
+     */
+    bool solved() const {
+        for(int f = 0; f != 6; ++f){
+            for(int ix = 1; ix < rank * rank; ++ix)
+                if(facelets[f * rank * rank + ix] != facelets[f * rank * rank]) return false;
+        }
+        return true;
+    }
+
+    bool operator==(const CubeState& other) const {
+        return rank == other.rank && facelets == other.facelets;
+    }
+
+    static FaceTexture solvedTexture(Face f){
+        static const FaceTexture tex[6] = {FACE_TEXTURE_1, FACE_TEXTURE_2, FACE_TEXTURE_3,
+                                           FACE_TEXTURE_4, FACE_TEXTURE_5, FACE_TEXTURE_6};
+        return tex[f];
+    }
+
+private:
+    int rank;
+    std::vector<std::uint8_t> facelets;
+    std::vector<std::uint8_t> scratch;
+    std::vector<int> moved;
+
+    // world space outward normal of each face
+    static constexpr int NORMALS[6][3] = {{0, 0, -1}, {0, 0, 1}, {-1, 0, 0}, {1, 0, 0}, {0, -1, 0}, {0, 1, 0}};
+    static constexpr int COS[4] = {1, 0, -1, 0};
+    static constexpr int SIN[4] = {0, 1, 0, -1};
+    // grid axis the i index of each face runs along, see toGrid
+    static constexpr int I_AXIS[6] = {1, 1, 1, 1, 2, 2};
+
+    // layer index of the face on the positive / negative side of an axis;
+    // z grows towards the back, i.e. along the negative world z axis
+    int outer(int axis) const { return axis == ROTATE_Z ? 0 : rank - 1; }
+    int inner(int axis) const { return axis == ROTATE_Z ? rank - 1 : 0; }
+
+    int index(Face f, int i, int j) const {
+        return (f * rank + i) * rank + j;
+    }
+
+    void toGrid(Face f, int i, int j, int* g) const {
+        switch(f){
+            case FACE_BACK:   g[0] = j; g[1] = i; g[2] = rank-1; break;
+            case FACE_FRONT:  g[0] = j; g[1] = i; g[2] = 0;      break;
+            case FACE_LEFT:   g[0] = 0; g[1] = i; g[2] = j;      break;
+            case FACE_RIGHT:  g[0] = rank-1; g[1] = i; g[2] = j; break;
+            case FACE_BUTTOM: g[0] = j; g[1] = 0; g[2] = i;      break;
+            case FACE_TOP:    g[0] = j; g[1] = rank-1; g[2] = i; break;
+        }
+    }
+
+    int gridIndex(Face f, const int* g) const {
+        switch(f){
+            case FACE_BACK:
+            case FACE_FRONT:  return index(f, g[1], g[0]);
+            case FACE_LEFT:
+            case FACE_RIGHT:  return index(f, g[1], g[2]);
+            case FACE_BUTTOM:
+            case FACE_TOP:    return index(f, g[2], g[0]);
+        }
+        return 0;
+    }
+
+    // index facelet f of the cubie at grid position g turns to, g is overwritten
+    int turned(Face f, int* g, int axis, int c, int s) const {
+        int p[3], n[3];
+        // centered coordinates, doubled so they stay integral
+        p[0] = 2 * g[0] - (rank - 1);
+        p[1] = 2 * g[1] - (rank - 1);
+        p[2] = (rank - 1) - 2 * g[2];
+        for(int k = 0; k != 3; ++k) n[k] = NORMALS[f][k];
+        rotate(axis, c, s, p);
+        rotate(axis, c, s, n);
+
+        g[0] = (p[0] + rank - 1) / 2;
+        g[1] = (p[1] + rank - 1) / 2;
+        g[2] = (rank - 1 - p[2]) / 2;
+        return gridIndex(toFace(n), g);
+    }
+
+    static Face toFace(const int* n){
+        if(n[0] != 0) return n[0] > 0 ? FACE_RIGHT : FACE_LEFT;
+        if(n[1] != 0) return n[1] > 0 ? FACE_TOP : FACE_BUTTOM;
+        return n[2] > 0 ? FACE_FRONT : FACE_BACK;
+    }
+
+    static void rotate(int axis, int c, int s, int* v){
+        int a, b;
+        switch(axis){
+            case ROTATE_X:
+                a = c * v[1] - s * v[2]; b = s * v[1] + c * v[2];
+                v[1] = a; v[2] = b;
+            break;
+            case ROTATE_Y:
+                a = c * v[0] + s * v[2]; b = -s * v[0] + c * v[2];
+                v[0] = a; v[2] = b;
+            break;
+            case ROTATE_Z:
+                a = c * v[0] - s * v[1]; b = s * v[0] + c * v[1];
+                v[0] = a; v[1] = b;
+            break;
+        }
+    }
+};
+
+#endif
@@ -0,0 +1,279 @@
+#ifndef CUBIE_CUBE_H_
+#define CUBIE_CUBE_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#if defined(__SSSE3__)
+#include <tmmintrin.h>
+#endif
+
+#include "cube_state.h"
+#include "cube_moves.h"
+
+/*
+ * Compact 3x3x3 state for batch simulation: 8 corners & 12 edges, one byte
+ * each holding the cubie index in the low nibble and its orientation in the
+ * high nibble. Corners and edges fill one 16-byte block each, so with SSSE3
+ * a face turn is one PSHUFB plus one add/xor per block.
+ *
+ * The 18 face turns, ordered U U2 U' R R2 R' F F2 F' D D2 D' L L2 L' B B2 B',
+ * are derived from CubeState::turn, so they mean exactly what MagicCube renders.
+ * Cubies follow the usual URF..DRB / UR..BR numbering.
+ */
+class CubieCube {
+public:
+    static const int NUM_MOVES = 18;
+    static const int NUM_CORNERS = 8;
+    static const int NUM_EDGES = 12;
+
+    /*
+     * Solved cube.
+     */
+    CubieCube(){
+        for(int ix = 0; ix != 16; ++ix){
+            corners[ix] = ix;
+            edges[ix] = ix;
+        }
+    }
+
+    int cornerPermutation(int ix) const { return corners[ix] & 0x0f; }
+    int cornerOrientation(int ix) const { return corners[ix] >> 4; }
+    int edgePermutation(int ix) const { return edges[ix] & 0x0f; }
+    int edgeOrientation(int ix) const { return edges[ix] >> 4; }
+
+    void setCorner(int ix, int perm, int ori){ corners[ix] = perm | (ori << 4); }
+    void setEdge(int ix, int perm, int ori){ edges[ix] = perm | (ori << 4); }
+
+    /*
+     * Apply one of the 18 face turns.
+     */
+    void move(int m){
+        const MoveTable& t = tables()[m];
+#if defined(__SSSE3__)
+        __m128i c = _mm_load_si128(reinterpret_cast<const __m128i*>(corners));
+        __m128i e = _mm_load_si128(reinterpret_cast<const __m128i*>(edges));
+        apply(t, c, e);
+        _mm_store_si128(reinterpret_cast<__m128i*>(corners), c);
+        _mm_store_si128(reinterpret_cast<__m128i*>(edges), e);
+#else
+        apply(t, corners, edges);
+#endif
+    }
+
+    /*
+     * Apply a sequence of face turns, keeping the state in registers.
+     */
+    void move(const std::uint8_t* moves, std::size_t n){
+        const MoveTable* t = tables();
+#if defined(__SSSE3__)
+        __m128i c = _mm_load_si128(reinterpret_cast<const __m128i*>(corners));
+        __m128i e = _mm_load_si128(reinterpret_cast<const __m128i*>(edges));
+        for(std::size_t ix = 0; ix != n; ++ix) apply(t[moves[ix]], c, e);
+        _mm_store_si128(reinterpret_cast<__m128i*>(corners), c);
+        _mm_store_si128(reinterpret_cast<__m128i*>(edges), e);
+#else
+        for(std::size_t ix = 0; ix != n; ++ix) apply(t[moves[ix]], corners, edges);
+#endif
+    }
+
+    void move(const std::vector<std::uint8_t>& moves){
+        move(moves.data(), moves.size());
+    }
+
+    bool solved() const { return *this == CubieCube(); }
+
+    bool operator==(const CubieCube& other) const {
+        return std::memcmp(corners, other.corners, NUM_CORNERS) == 0 &&
+               std::memcmp(edges, other.edges, NUM_EDGES) == 0;
+    }
+
+    bool operator!=(const CubieCube& other) const { return !(*this == other); }
+
+    /*
+     * The face turn m as a Move of a rank 3 CubeState.
+     */
+    static Move toMove(int m){
+        static const char* suffix[3] = {"", "2", "'"};
+        Move move;
+        parseMove(std::string(1, FACE_LETTERS[m / 3]) + suffix[m % 3], 3, move);
+        return move;
+    }
+
+    static std::string moveName(int m){
+        static const char* suffix[3] = {"", "2", "'"};
+        return std::string(1, FACE_LETTERS[m / 3]) + suffix[m % 3];
+    }
+
+    /*
+     * Read the cubies of a rank 3 state. Faces are identified by the color
+     * of their center, so whole cube rotations are allowed.
+     *
+     * @return false if the state is not a valid 3x3x3 coloring
+     */
+    static bool fromState(const CubeState& state, CubieCube& cube){
+        if(state.getRank() != 3) return false;
+
+        int letter_of[7];
+        for(int ix = 0; ix != 7; ++ix) letter_of[ix] = -1;
+        for(int ix = 0; ix != 6; ++ix)
+            letter_of[state.facelet(LETTER_FACES[ix], 1, 1)] = ix;
+
+        for(int ix = 0; ix != NUM_CORNERS; ++ix){
+            int col[3];
+            for(int k = 0; k != 3; ++k){
+                const Facelet& f = CORNER_FACELETS[ix][k];
+                col[k] = letter_of[state.cubieFace(f.x, f.y, f.z, LETTER_FACES[f.letter])];
+            }
+            int ori = 0;
+            while(ori != 3 && col[ori] != 0 && col[ori] != 3) ++ori;
+            if(ori == 3) return false;
+            int jx = 0;
+            while(jx != NUM_CORNERS && !(CORNER_FACELETS[jx][1].letter == col[(ori + 1) % 3] &&
+                                          CORNER_FACELETS[jx][2].letter == col[(ori + 2) % 3])) ++jx;
+            if(jx == NUM_CORNERS) return false;
+            cube.setCorner(ix, jx, ori);
+        }
+
+        for(int ix = 0; ix != NUM_EDGES; ++ix){
+            int col[2];
+            for(int k = 0; k != 2; ++k){
+                const Facelet& f = EDGE_FACELETS[ix][k];
+                col[k] = letter_of[state.cubieFace(f.x, f.y, f.z, LETTER_FACES[f.letter])];
+            }
+            int jx = 0, ori = -1;
+            for(; jx != NUM_EDGES; ++jx){
+                if(EDGE_FACELETS[jx][0].letter == col[0] && EDGE_FACELETS[jx][1].letter == col[1]){ ori = 0; break; }
+                if(EDGE_FACELETS[jx][0].letter == col[1] && EDGE_FACELETS[jx][1].letter == col[0]){ ori = 1; break; }
+            }
+            if(ori < 0) return false;
+            cube.setEdge(ix, jx, ori);
+        }
+        return true;
+    }
+
+    /*
+     * Rank 3 state with solved centers showing this cube.
+     */
+    CubeState toState() const {
+        CubeState state(3);
+        for(int ix = 0; ix != NUM_CORNERS; ++ix){
+            int jx = cornerPermutation(ix), ori = cornerOrientation(ix);
+            for(int k = 0; k != 3; ++k){
+                const Facelet& f = CORNER_FACELETS[ix][(k + ori) % 3];
+                state.setCubieFace(f.x, f.y, f.z, LETTER_FACES[f.letter],
+                                   CubeState::solvedTexture(LETTER_FACES[CORNER_FACELETS[jx][k].letter]));
+            }
+        }
+        for(int ix = 0; ix != NUM_EDGES; ++ix){
+            int jx = edgePermutation(ix), ori = edgeOrientation(ix);
+            for(int k = 0; k != 2; ++k){
+                const Facelet& f = EDGE_FACELETS[ix][(k + ori) % 2];
+                state.setCubieFace(f.x, f.y, f.z, LETTER_FACES[f.letter],
+                                   CubeState::solvedTexture(LETTER_FACES[EDGE_FACELETS[jx][k].letter]));
+            }
+        }
+        return state;
+    }
+
+private:
+    alignas(16) std::uint8_t corners[16];
+    alignas(16) std::uint8_t edges[16];
+
+    // faces in the order U R F D L B used by the move numbering
+    static constexpr char FACE_LETTERS[7] = "URFDLB";
+    static constexpr Face LETTER_FACES[6] = {FACE_TOP, FACE_RIGHT, FACE_FRONT, FACE_BUTTOM, FACE_LEFT, FACE_BACK};
+
+    // a facelet of a cubie: grid position of the cubie & face letter index
+    struct Facelet { int x, y, z, letter; };
+
+    // facelets of each corner, U/D facelet first then clockwise
+    static constexpr Facelet CORNER_FACELETS[NUM_CORNERS][3] = {
+        {{2, 2, 0, 0}, {2, 2, 0, 1}, {2, 2, 0, 2}},  // URF
+        {{0, 2, 0, 0}, {0, 2, 0, 2}, {0, 2, 0, 4}},  // UFL
+        {{0, 2, 2, 0}, {0, 2, 2, 4}, {0, 2, 2, 5}},  // ULB
+        {{2, 2, 2, 0}, {2, 2, 2, 5}, {2, 2, 2, 1}},  // UBR
+        {{2, 0, 0, 3}, {2, 0, 0, 2}, {2, 0, 0, 1}},  // DFR
+        {{0, 0, 0, 3}, {0, 0, 0, 4}, {0, 0, 0, 2}},  // DLF
+        {{0, 0, 2, 3}, {0, 0, 2, 5}, {0, 0, 2, 4}},  // DBL
+        {{2, 0, 2, 3}, {2, 0, 2, 1}, {2, 0, 2, 5}}   // DRB
+    };
+
+    static constexpr Facelet EDGE_FACELETS[NUM_EDGES][2] = {
+        {{2, 2, 1, 0}, {2, 2, 1, 1}},  // UR
+        {{1, 2, 0, 0}, {1, 2, 0, 2}},  // UF
+        {{0, 2, 1, 0}, {0, 2, 1, 4}},  // UL
+        {{1, 2, 2, 0}, {1, 2, 2, 5}},  // UB
+        {{2, 0, 1, 3}, {2, 0, 1, 1}},  // DR
+        {{1, 0, 0, 3}, {1, 0, 0, 2}},  // DF
+        {{0, 0, 1, 3}, {0, 0, 1, 4}},  // DL
+        {{1, 0, 2, 3}, {1, 0, 2, 5}},  // DB
+        {{2, 1, 0, 2}, {2, 1, 0, 1}},  // FR
+        {{0, 1, 0, 2}, {0, 1, 0, 4}},  // FL
+        {{0, 1, 2, 5}, {0, 1, 2, 4}},  // BL
+        {{2, 1, 2, 5}, {2, 1, 2, 1}}   // BR
+    };
+
+    /*
+     * A face turn as "replaced by" permutations & orientation changes:
+     * after the turn, position i holds what was at perm[i], with its
+     * orientation increased by ori[i] (mod 3 for corners, mod 2 for edges).
+     */
+    struct MoveTable {
+        alignas(16) std::uint8_t corner_perm[16];
+        alignas(16) std::uint8_t corner_ori[16];
+        alignas(16) std::uint8_t edge_perm[16];
+        alignas(16) std::uint8_t edge_ori[16];
+    };
+
+    static const MoveTable* tables(){
+        static const std::vector<MoveTable> t = buildTables();
+        return t.data();
+    }
+
+    static std::vector<MoveTable> buildTables(){
+        std::vector<MoveTable> t(NUM_MOVES);
+        for(int m = 0; m != NUM_MOVES; ++m){
+            CubeState state(3);
+            applyMove(state, toMove(m));
+            CubieCube cube;
+            fromState(state, cube);
+            for(int ix = 0; ix != 16; ++ix){
+                t[m].corner_perm[ix] = ix < NUM_CORNERS ? cube.cornerPermutation(ix) : ix;
+                t[m].corner_ori[ix] = ix < NUM_CORNERS ? cube.cornerOrientation(ix) << 4 : 0;
+                t[m].edge_perm[ix] = ix < NUM_EDGES ? cube.edgePermutation(ix) : ix;
+                t[m].edge_ori[ix] = ix < NUM_EDGES ? cube.edgeOrientation(ix) << 4 : 0;
+            }
+        }
+        return t;
+    }
+
+#if defined(__SSSE3__)
+    static void apply(const MoveTable& t, __m128i& c, __m128i& e){
+        const __m128i three = _mm_set1_epi8(0x30);
+        c = _mm_shuffle_epi8(c, _mm_load_si128(reinterpret_cast<const __m128i*>(t.corner_perm)));
+        c = _mm_add_epi8(c, _mm_load_si128(reinterpret_cast<const __m128i*>(t.corner_ori)));
+        // orientation mod 3: subtracting 3 wraps around unless the orientation is >= 3
+        c = _mm_min_epu8(c, _mm_sub_epi8(c, three));
+        e = _mm_shuffle_epi8(e, _mm_load_si128(reinterpret_cast<const __m128i*>(t.edge_perm)));
+        e = _mm_xor_si128(e, _mm_load_si128(reinterpret_cast<const __m128i*>(t.edge_ori)));
+    }
+#endif
+
+    static void apply(const MoveTable& t, std::uint8_t* c, std::uint8_t* e){
+        std::uint8_t tmp[16];
+        for(int ix = 0; ix != NUM_CORNERS; ++ix){
+            std::uint8_t v = c[t.corner_perm[ix]] + t.corner_ori[ix];
+            tmp[ix] = v >= 0x30 ? v - 0x30 : v;
+        }
+        std::memcpy(c, tmp, NUM_CORNERS);
+        for(int ix = 0; ix != NUM_EDGES; ++ix)
+            tmp[ix] = e[t.edge_perm[ix]] ^ t.edge_ori[ix];
+        std::memcpy(e, tmp, NUM_EDGES);
+    }
+};
+
+#endif
@@ -0,0 +1,79 @@
+#ifndef GL_RESOURCES_H_
+#define GL_RESOURCES_H_
+
+#include <glad/glad.h>
+
+#include <vector>
+
+/*
+ * Owner of GPU objects.
+ * Every vertex array, buffer, texture, framebuffer and renderbuffer
+ * generated through this class is deleted by release(), which has to run
+ * while the GL context is alive, i.e. before glfwTerminate.
+ */
+class GLResources {
+public:
+    GLResources() = default;
+    GLResources(const GLResources&) = delete;
+    GLResources& operator=(const GLResources&) = delete;
+
+    GLuint genVertexArray(){
+        GLuint handle;
+        glGenVertexArrays(1, &handle);
+        vertex_arrays.push_back(handle);
+        return handle;
+    }
+
+    GLuint genBuffer(){
+        GLuint handle;
+        glGenBuffers(1, &handle);
+        buffers.push_back(handle);
+        return handle;
+    }
+
+    GLuint genTexture(){
+        GLuint handle;
+        glGenTextures(1, &handle);
+        textures.push_back(handle);
+        return handle;
+    }
+
+    GLuint genFramebuffer(){
+        GLuint handle;
+        glGenFramebuffers(1, &handle);
+        framebuffers.push_back(handle);
+        return handle;
+    }
+
+    GLuint genRenderbuffer(){
+        GLuint handle;
+        glGenRenderbuffers(1, &handle);
+        renderbuffers.push_back(handle);
+        return handle;
+    }
+
+    /*
+     * Delete every object generated so far.
+     */
+    void release(){
+        if(!vertex_arrays.empty()) glDeleteVertexArrays(vertex_arrays.size(), vertex_arrays.data());
+        if(!buffers.empty()) glDeleteBuffers(buffers.size(), buffers.data());
+        if(!textures.empty()) glDeleteTextures(textures.size(), textures.data());
+        if(!framebuffers.empty()) glDeleteFramebuffers(framebuffers.size(), framebuffers.data());
+        if(!renderbuffers.empty()) glDeleteRenderbuffers(renderbuffers.size(), renderbuffers.data());
+        vertex_arrays.clear();
+        buffers.clear();
+        textures.clear();
+        framebuffers.clear();
+        renderbuffers.clear();
+    }
+
+private:
+    std::vector<GLuint> vertex_arrays;
+    std::vector<GLuint> buffers;
+    std::vector<GLuint> textures;
+    std::vector<GLuint> framebuffers;
+    std::vector<GLuint> renderbuffers;
+};
+
+#endif
@@ -0,0 +1,97 @@
+#ifndef HEADLESS_CONTEXT_H_
+#define HEADLESS_CONTEXT_H_
+
+/*
+ * OpenGL 3.3 core context without a window or display server, through EGL.
+ * Only compiled with MAGIC_CUBE_EGL defined; link with -lEGL.
+ *
+ * Mesa's surfaceless platform comes first, it needs no display server at
+ * all, e.g. llvmpipe on a server without a GPU. Otherwise the default EGL
+ * display is used with a 1x1 pbuffer. Frames are drawn into framebuffer
+ * objects either way, see OffscreenRenderer.
+ */
+#ifdef MAGIC_CUBE_EGL
+
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+
+#include <iostream>
+
+class HeadlessContext {
+public:
+    HeadlessContext() = default;
+    HeadlessContext(const HeadlessContext&) = delete;
+    HeadlessContext& operator=(const HeadlessContext&) = delete;
+    ~HeadlessContext(){ destroy(); }
+
+    /*
+     * Create the context and make it current on the calling thread.
+     *
+     * @return false if no EGL display offers an OpenGL 3.3 core context
+     */
+    bool create(){
+        PFNEGLGETPLATFORMDISPLAYEXTPROC getPlatformDisplay =
+            (PFNEGLGETPLATFORMDISPLAYEXTPROC)eglGetProcAddress("eglGetPlatformDisplayEXT");
+        if(getPlatformDisplay) display = getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, NULL);
+        bool surfaceless = display != EGL_NO_DISPLAY && eglInitialize(display, NULL, NULL);
+        if(!surfaceless){
+            display = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+            if(display == EGL_NO_DISPLAY || !eglInitialize(display, NULL, NULL)){
+                std::cerr << "Failed to initialize an EGL display" << std::endl;
+                display = EGL_NO_DISPLAY;
+                return false;
+            }
+        }
+
+        const EGLint config_attribs[] = {EGL_SURFACE_TYPE, surfaceless ? 0 : EGL_PBUFFER_BIT,
+                                         EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT, EGL_NONE};
+        const EGLint context_attribs[] = {EGL_CONTEXT_MAJOR_VERSION, 3, EGL_CONTEXT_MINOR_VERSION, 3,
+                                          EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT, EGL_NONE};
+        const EGLint pbuffer_attribs[] = {EGL_WIDTH, 1, EGL_HEIGHT, 1, EGL_NONE};
+        EGLConfig config;
+        EGLint num_configs = 0;
+        bool ok = eglChooseConfig(display, config_attribs, &config, 1, &num_configs) && num_configs == 1 &&
+                  eglBindAPI(EGL_OPENGL_API);
+        if(ok) context = eglCreateContext(display, config, EGL_NO_CONTEXT, context_attribs);
+        ok = ok && context != EGL_NO_CONTEXT;
+        // the surfaceless platform draws into framebuffer objects only
+        if(ok && !surfaceless){
+            surface = eglCreatePbufferSurface(display, config, pbuffer_attribs);
+            ok = surface != EGL_NO_SURFACE;
+        }
+        ok = ok && eglMakeCurrent(display, surface, surface, context);
+        if(!ok){
+            std::cerr << "Failed to create an EGL OpenGL 3.3 core context (error 0x" << std::hex << eglGetError() << std::dec << ")" << std::endl;
+            destroy();
+        }
+        return ok;
+    }
+
+    /*
+     * Release the context, every GL object has to be released before.
+     */
+    void destroy(){
+        if(display == EGL_NO_DISPLAY) return;
+        eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+        if(surface != EGL_NO_SURFACE) eglDestroySurface(display, surface);
+        if(context != EGL_NO_CONTEXT) eglDestroyContext(display, context);
+        eglTerminate(display);
+        display = EGL_NO_DISPLAY;
+        context = EGL_NO_CONTEXT;
+        surface = EGL_NO_SURFACE;
+    }
+
+    // loader for glad
+    static void* getProcAddress(const char* name){
+        return (void*)eglGetProcAddress(name);
+    }
+
+private:
+    EGLDisplay display = EGL_NO_DISPLAY;
+    EGLContext context = EGL_NO_CONTEXT;
+    EGLSurface surface = EGL_NO_SURFACE;
+};
+
+#endif
+
+#endif
@@ -5,212 +5,360 @@
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtc/type_ptr.hpp>
 
-#define STB_IMAGE_IMPLEMENTATION
-#include "stb_image.h"
+#include <algorithm>
+#include <cmath>
 
-#include "cube.h"
+#include "ray.h"
+#include "triangle.h"
+#include "shader.h"
+#include "cube_mesh.h"
+#include "cube_state.h"
+#include "cube_moves.h"
+#include "cube_renderer.h"
+
+/*
+ * Renderer & picking on top of the GL-free puzzle core
+ * (cube_state.h, cube_moves.h), which can be used without a GL context.
+ */
 
-enum RotateState {ROTATE_X, ROTATE_Y, ROTATE_Z, ROTATE_NONE};
 enum RotateMode  {ROTATE_GLOBAL, ROTATE_LOCAL};
-enum RotateLayer {LAYER_ONE, LAYER_TWO, LAYER_THREE, LAYER_FOUR, LAYER_FIVE, LAYER_SIX, LAYER_ALL, LAYER_NONE};
 
 class MagicCube {
 public:
     /*
      * MagicCube default constructor.
-     * Intialize texture image & model matrix for each cube
+     * Intialize the logical state & the face instances drawn from it
      */
     MagicCube(): rank(3) { init(); }
     MagicCube(int rank_): rank(rank_) { init(); }
 
     void init(){
-        /* Initilize face textures & position of each cube */
+        state.reset(rank);
+
+        /* One instance per facelet, the only faces seen from outside */
         // ---------------------------------------
-        glm::mat4 model;
-        glm::vec3 curr_pos;
-        int curr_ix;
+        // resize keeps the capacity, so storage only grows past the largest rank used so far
         float cube_length = length / rank;
-        cubes = std::vector<Cube>(rank * rank * rank);
-
-        for(int layer = 0; layer != rank; ++layer){
-            for(int row = 0; row != rank; ++row){
-                for(int col = 0; col != rank; ++col){
-                    curr_pos = glm::vec3(col+0.5f, layer+0.5f, -row-0.5f) * glm::vec3(cube_length);                    
-                    model = glm::translate(glm::mat4(1.0f), curr_pos);
-                    model = glm::scale(model, glm::vec3(cube_length));
-                    curr_ix = rank * (layer * rank + row) + col;
-                    cubes[curr_ix].setModel(model);
-
-                    if(layer == 0) cubes[curr_ix].setFaceTexture(FACE_BUTTOM, FACE_TEXTURE_5);
-                    if(layer == rank-1) cubes[curr_ix].setFaceTexture(FACE_TOP, FACE_TEXTURE_6);
-                    if(row == 0) cubes[curr_ix].setFaceTexture(FACE_FRONT, FACE_TEXTURE_2);
-                    if(row == rank-1) cubes[curr_ix].setFaceTexture(FACE_BACK, FACE_TEXTURE_1);
-                    if(col == 0) cubes[curr_ix].setFaceTexture(FACE_LEFT, FACE_TEXTURE_3);
-                    if(col == rank-1) cubes[curr_ix].setFaceTexture(FACE_RIGHT, FACE_TEXTURE_4);
-                }
-            }
+        glm::mat4 frames[6];
+        for(int f = 0; f != 6; ++f) frames[f] = CubeMesh::faceFrame(f);
+        instances.resize(state.numFacelets());
+        for(int ix = 0; ix != state.numFacelets(); ++ix){
+            Face f = FACE_BACK;
+            int g[3] = {0, 0, 0};
+            state.faceletGrid(ix, f, g);
+            glm::vec3 curr_pos = glm::vec3(g[0]+0.5f, g[1]+0.5f, -g[2]-0.5f) * glm::vec3(cube_length);
+            glm::mat4 model = glm::translate(glm::mat4(1.0f), curr_pos);
+            model = glm::scale(model, glm::vec3(cube_length));
+            instances[ix].model = model * frames[f];
+            for(int axis = 0; axis != 3; ++axis) instances[ix].grid[axis] = g[axis];
         }
+        cut_state = ROTATE_NONE;
+        cut_layer = LAYER_NONE;
+        geometry_changed = true;
+        syncTextures();
+    }
+
+    /*
+     * Derive face textures from the logical state.
+     * Cubes never leave their grid position, a committed rotation only
+     * moves facelets around in the state, so the cached instances, one per
+     * facelet, only need their textures refreshed.
+     */
+    void syncTextures(){
+        for(int ix = 0; ix != state.numFacelets(); ++ix)
+            instances[ix].texture = state.facelet(ix);
+        instances_changed = true;
     }
 
     void setRank(int rank_){
+        if(rank_ == rank) return;
         rank = rank_;
         init();
     }
 
+    int getRank() const { return rank; }
+
     /*
-    * Load Texture images in batch mode.
-    * Note that the images should be in .png format.
+    * Upload the face textures, one layer of the texture pack per texture index.
     * 
-    * @param n: # textures to be loaded
-    * @param paths: corresponding texture paths
-    * @param textures: pre-allocated array to hold the resulting texture handlers
+    * @param pack: baked textures, see TexturePack
     */
-    void loadTextures(GLuint n, const std::string* paths){
-        textures = new GLuint[n];
-        for(int ix = 0; ix != n; ++ix){
-            glGenTextures(1, textures + ix);
-            // glActiveTexture(GL_TEXTURE0);
-            glBindTexture(GL_TEXTURE_2D, textures[ix]);
-            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-
-            int width, height, nrchannels;
-            unsigned char *data = stbi_load(paths[ix].c_str(), &width, &height, &nrchannels, 0);
-            if(!data){
-                std::cerr << "Failed to load texture image " << paths[ix] << std::endl;
-            }
-            else{
-                glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, data);
-                glGenerateMipmap(GL_TEXTURE_2D);
-            }
-            stbi_image_free(data);
-        }
+    void loadTextures(const TexturePack& pack){
+        renderer.loadTextures(pack);
+    }
+
+    /*
+     * Draw stickers from the face textures, or procedurally without them.
+     * The shader has to be switched along, see FrameUniforms::proceduralStickers.
+     */
+    void setTextured(bool textured){
+        renderer.setTextured(textured);
+    }
+
+    /*
+     * Draw instanced, or from one merged vertex buffer, see MeshMode.
+     */
+    void setMeshMode(MeshMode mode){
+        if(mode == renderer.getMeshMode()) return;
+        renderer.setMeshMode(mode);
+        instances_changed = geometry_changed = true;
+    }
+
+    /*
+     * Release textures & buffers held by the renderer.
+     * Call before the GL context is destroyed.
+     */
+    void finishDrawing(){
+        renderer.finishDrawing();
+        instances_changed = geometry_changed = true;
     }
 
     /*
-     * Draw current magic cube.
+     * Draw current magic cube with a single instanced draw call.
      * Call loadTextures before calling this method.
+     *
+     * Only faces seen from outside are drawn, plus black caps closing the
+     * cuts around the turning layer, so the hollow inside never shows.
+     * Instances are uploaded only after a change of state or of the turning
+     * layer. Otherwise a turning layer costs three uniforms: the shader picks
+     * its faces by grid position and applies the pivot, so no cube is touched
+     * on the CPU while animating.
      * 
-     * @param shader: shader program used to render the magic cube
+     * @param shader: shader program used to render the magic cube, in use
      */
-    void draw(const Shader& shader, RotateState state, RotateLayer layer, float angle){
-        glm::vec3 axis = glm::vec3(1.0f, 0, 0);
-        glm::vec3 center;
-        glm::mat4 model;
-
-        if(state == ROTATE_X){
-            axis = glm::vec3(1.0f, 0, 0);
-            center = glm::vec3(0, 0.5f, -0.5f) * glm::vec3(length);
-        }
-        if(state == ROTATE_Y){
-            axis = glm::vec3(0, 1.0f, 0);
-            center = glm::vec3(0.5f, 0, -0.5f) * glm::vec3(length);
-        }
-        if(state == ROTATE_Z){
-            axis = glm::vec3(0, 0, 1.0f);
-            center = glm::vec3(0.5f, 0.5f, 0) * glm::vec3(length);
-        }
-
-        for(int ix = 0; ix != cubes.size(); ++ix){
-            if(cube_qualified(ix, state, layer))
-                cubes[ix].draw(shader, textures, axis, center, angle);
-            else
-                cubes[ix].draw(shader, textures, axis, center, 0);
+    void draw(const Shader& shader, RotateState state, int layer, float angle){
+        if(state != ROTATE_NONE && layer != LAYER_NONE && (state != cut_state || layer != cut_layer))
+            cutLayer(state, layer);
+        if(instances_changed){
+            renderer.upload(instances, geometry_changed);
+            instances_changed = geometry_changed = false;
         }
+        bool turning = state != ROTATE_NONE && layer != LAYER_NONE && angle != 0;
+        shader.setInt("turnAxis", turning ? state : ROTATE_NONE);
+        shader.setInt("turnLayer", layer);
+        if(turning) shader.setMat4("turnPivot", pivotMatrix(state, angle));
+        renderer.draw();
     }
     
     /*
-     * Rotate the magic cube as a whole
+     * Commit a rotation of one layer, or of the magic cube as a whole
      *
-     * @param axis: rotation axis
+     * @param state: rotation axis
+     * @param layer: layer to rotate, LAYER_ALL for the whole cube
      * @param angle: rotation angle, expressed in degrees
      */
-    void rotate(RotateState state, RotateLayer layer, float angle){
-        glm::vec3 axis;
-        glm::vec3 center;
+    void rotate(RotateState state_, int layer, float angle){
+        if(state_ == ROTATE_NONE || layer == LAYER_NONE) return;
 
-        if(state == ROTATE_X){
-            axis = glm::vec3(1.0f, 0, 0);
-            center = glm::vec3(0, 0.5f, -0.5f) * glm::vec3(length);
-        }
-        if(state == ROTATE_Y){
-            axis = glm::vec3(0, 1.0f, 0);
-            center = glm::vec3(0.5f, 0, -0.5f) * glm::vec3(length);
-        }
-        if(state == ROTATE_Z){
-            axis = glm::vec3(0, 0, 1.0f);
-            center = glm::vec3(0.5f, 0.5f, 0) * glm::vec3(length);
-        }
+        int quarters = static_cast<int>(std::lround(angle / 90.0f));
+        state.turn(state_, layer, quarters);
+        syncTextures();
+    }
 
-        for(int ix = 0; ix != cubes.size(); ++ix){
-            if(cube_qualified(ix, state, layer)){
-                cubes[ix].rotate(axis, center, angle);
-            }
-        }
+    /*
+     * Apply moves to the logical state, e.g. a parsed sequence or a scramble.
+     */
+    void apply(const std::vector<Move>& moves){
+        applyMoves(state, moves);
+        syncTextures();
     }
 
-    bool cube_qualified(int cube_ix, const RotateState state, const RotateLayer layer){
-        if(state == ROTATE_NONE) return false;
-        if(layer == LAYER_ALL) return true;
+    /*
+     * Apply a compiled sequence in one pass.
+     *
+     * @return false if the sequence was compiled for another rank
+     */
+    bool apply(const CompiledMoves& moves){
+        if(!moves.apply(state)) return false;
+        syncTextures();
+        return true;
+    }
 
-        float cube_length = length / rank;
-        float layer_center = (0.5 + static_cast<int>(layer)) * cube_length;
-
-        bool qualified;
-        switch(state){
-            case ROTATE_X:
-                qualified = fabs(cubes[cube_ix].getCenter().x - layer_center) < 1e-5f;
-            break;
-            case ROTATE_Y:
-                qualified = fabs(cubes[cube_ix].getCenter().y - layer_center) < 1e-5f;
-            break;
-            case ROTATE_Z:
-                qualified = fabs(cubes[cube_ix].getCenter().z + layer_center) < 1e-5f;
-            break;
-            default:
-            break;
+    const CubeState& getState() const { return state; }
+
+    /*
+     * Replace the logical state, changing rank if needed.
+     */
+    void setState(const CubeState& state_){
+        if(state_.getRank() != rank){
+            rank = state_.getRank();
+            init();
         }
-        return qualified;
+        state = state_;
+        syncTextures();
     }
 
-    RotateLayer getLayer(float coord){
-        RotateLayer layer;
+    /*
+     * Index of the layer containing a coordinate along some axis.
+     * Coordinates along the z axis should be negated before calling.
+     */
+    int getLayer(float coord){
+        if(coord < -1e-4f || coord > length + 1e-4f) return LAYER_NONE;
+
         float cube_length = length / rank;
-        float center;
+        int ix = static_cast<int>(std::floor(coord / cube_length));
+        return std::min(std::max(ix, 0), rank - 1);
+    }
 
-        for(int ix = 0; ix != rank; ++ix){
-            center = (ix + 0.5) * cube_length;
-            if(fabs(coord - center) < cube_length / 2){
-                return RotateLayer(ix);
-            }
+    bool hit(const Ray& ray, double t_min, double t_max, HitRecord& rec){
+        return hit(ray, t_min, t_max, rec, ROTATE_NONE, LAYER_NONE, 0);
+    }
+
+    /*
+     * Intersect a ray with the magic cube analytically.
+     * The ray is tested against the bounding box of the puzzle and the hit
+     * point is mapped to a face & cube directly. While a layer is turning,
+     * the static remainder and the turning layer are tested as separate boxes.
+     *
+     * The hit point is reported in the unrotated frame of the cube it lies on,
+     * i.e. where it would be once the rotation is undone.
+     */
+    bool hit(const Ray& ray, double t_min, double t_max, HitRecord& rec,
+             RotateState state, int layer, float angle){
+        const float cube_length = length / rank;
+        const AABB bounds(glm::vec3(0, 0, -length), glm::vec3(length, length, 0));
+        float t;
+        int axis;
+
+        bool animating = state != ROTATE_NONE && layer != LAYER_NONE &&
+                         std::fmod(std::fabs(angle), 90.0f) > 1e-3f;
+        if(!animating){
+            if(!bounds.hit(ray, t_min, t_max, t, axis)) return false;
+            fillHitRecord(ray, t, axis, bounds, rec);
+            return true;
         }
 
-        return LAYER_NONE;
-    }
+        // bring the ray into the frame of the turning layer
+        glm::mat4 inverse_pivot = pivotMatrix(state, -angle);
+        Ray local_ray(glm::vec3(inverse_pivot * glm::vec4(ray.origin, 1.0f)),
+                      glm::mat3(inverse_pivot) * ray.direction);
+        if(layer == LAYER_ALL){
+            if(!bounds.hit(local_ray, t_min, t_max, t, axis)) return false;
+            fillHitRecord(local_ray, t, axis, bounds, rec);
+            return true;
+        }
+
+        // split the bounding box along the axis into the turning layer and
+        // the static boxes below & above it; z layers grow towards -z
+        AABB boxes[3] = {bounds, bounds, bounds};
+        float lo = layer * cube_length, hi = (layer + 1) * cube_length;
+        if(state == ROTATE_Z){
+            float tmp = lo;
+            lo = -hi;
+            hi = -tmp;
+        }
+        boxes[0].lo[state] = boxes[1].hi[state] = lo;
+        boxes[0].hi[state] = boxes[2].lo[state] = hi;
 
-    bool hit(const Ray& ray, double t_min, double t_max, HitRecord& rec){
         bool ishit = false;
-        for(int ix = 0; ix != cubes.size(); ++ix){
-            if(cubes[ix].hit(ray, t_min, t_max, rec)){
-                t_max = rec.t;
+        for(int ix = 0; ix != 3; ++ix){
+            const Ray& r = ix == 0 ? local_ray : ray;
+            if(boxes[ix].hi[state] - boxes[ix].lo[state] < 1e-6f) continue;
+            if(boxes[ix].hit(r, t_min, t_max, t, axis)){
+                t_max = t;
                 ishit = true;
-                rec.ix = ix;
+                fillHitRecord(r, t, axis, boxes[ix], rec);
             }
         }
-        if(!ishit){
-            return false;
-        }
-        glm::vec3 hit_point = rec.p;
-        return true;
+        return ishit;
     }
 
 private:
     int rank;
     float length = 1.2;
-    std::vector<Cube> cubes;
-    GLuint* textures;
+    CubeState state;
+    std::vector<FaceInstance> instances;   // one per facelet, then the caps of the cut layer
+    bool instances_changed = true;         // not yet uploaded to the renderer
+    bool geometry_changed = true;          // more than textures changed since the last upload
+    RotateState cut_state = ROTATE_NONE;   // layer the caps were made for
+    int cut_layer = LAYER_NONE;
+    CubeRenderer renderer;
+
+    /*
+     * Replace the caps by those of a layer: on every inner plane bounding
+     * it, one black quad facing out of the layer, turning with it, and one
+     * facing into it, belonging to the static neighbour.
+     */
+    void cutLayer(RotateState axis, int layer){
+        // faces looking towards lower / higher grid coordinates, z rows grow towards -z
+        static const Face lower[3] = {FACE_LEFT, FACE_BUTTOM, FACE_FRONT};
+        static const Face upper[3] = {FACE_RIGHT, FACE_TOP, FACE_BACK};
+        const float cube_length = length / rank;
+
+        instances.resize(state.numFacelets());
+        cut_state = axis;
+        cut_layer = layer;
+        instances_changed = geometry_changed = true;
+        if(layer == LAYER_ALL) return;
+
+        for(int plane = layer; plane != layer + 2; ++plane){
+            if(plane == 0 || plane == rank) continue;
+            glm::vec3 center = glm::vec3(0.5f, 0.5f, -0.5f) * glm::vec3(length);
+            center[axis] = (axis == ROTATE_Z ? -plane : plane) * cube_length;
+            bool below = plane == layer;   // plane between layer - 1 & layer
+            addCap(center, below ? lower[axis] : upper[axis], axis, layer);
+            addCap(center, below ? upper[axis] : lower[axis], axis, below ? layer - 1 : layer + 1);
+        }
+    }
+
+    // a length x length black quad centered on a cut plane
+    void addCap(const glm::vec3& center, Face f, RotateState axis, int layer){
+        glm::mat4 frame = CubeMesh::faceFrame(f);
+        glm::vec3 normal(frame[2]);
+        glm::mat4 model = glm::translate(glm::mat4(1.0f), center - 0.5f * length * normal);
+        model = glm::scale(model, glm::vec3(length));
+        instances.emplace_back();
+        instances.back().model = model * frame;
+        instances.back().texture = FACE_TEXTURE_0;
+        instances.back().grid[0] = instances.back().grid[1] = instances.back().grid[2] = 0;
+        instances.back().grid[axis] = layer;
+    }
+
+    /*
+     * Rotation of a layer around the center line of the magic cube.
+     * The axis is a coordinate axis, so the rotation is filled in from one
+     * sine & cosine, and the pivot folds into the translation column.
+     */
+    glm::mat4 pivotMatrix(RotateState state, float angle) const {
+        glm::mat4 pivot(1.0f);
+        if(state == ROTATE_NONE) return pivot;
+
+        float c = std::cos(glm::radians(angle)), s = std::sin(glm::radians(angle));
+        int u = (state + 1) % 3, v = (state + 2) % 3;   // the plane turned in
+        pivot[u][u] = c;
+        pivot[u][v] = s;
+        pivot[v][u] = -s;
+        pivot[v][v] = c;
+
+        // center of the magic cube, z grows towards the viewer
+        glm::vec3 center = glm::vec3(0.5f, 0.5f, -0.5f) * glm::vec3(length);
+        center[state] = 0;
+        glm::vec3 offset = center - glm::mat3(pivot) * center;
+        pivot[3] = glm::vec4(offset, 1.0f);
+        return pivot;
+    }
+
+    /*
+     * Map a box entry point to the face & cube being hit.
+     * The coordinate along the entry axis is snapped onto the box plane.
+     */
+    void fillHitRecord(const Ray& ray, float t, int axis, const AABB& box, HitRecord& rec) const {
+        static const Face faces[3][2] = {{FACE_LEFT, FACE_RIGHT}, {FACE_BUTTOM, FACE_TOP}, {FACE_BACK, FACE_FRONT}};
+        const float cube_length = length / rank;
+        bool positive = ray.direction[axis] < 0;
+
+        rec.t = t;
+        rec.p = ray.at(t);
+        rec.p[axis] = positive ? box.hi[axis] : box.lo[axis];
+        rec.face = faces[axis][positive];
+
+        // step half a cube inwards so the point is not on a cube boundary
+        glm::vec3 inner = rec.p;
+        inner[axis] += (positive ? -0.5f : 0.5f) * cube_length;
+        glm::ivec3 grid(std::floor(inner.x / cube_length), std::floor(inner.y / cube_length),
+                        std::floor(-inner.z / cube_length));
+        rec.grid = glm::clamp(grid, glm::ivec3(0), glm::ivec3(rank - 1));
+    }
 };
 
 #endif
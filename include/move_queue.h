@@ -0,0 +1,139 @@
+#ifndef MOVE_QUEUE_H_
+#define MOVE_QUEUE_H_
+
+#include <cmath>
+#include <deque>
+#include <vector>
+
+#include "cube_state.h"
+#include "cube_moves.h"
+
+/*
+ * Moves waiting to be animated, e.g. parsed notation or solver output.
+ *
+ * Moves turn one at a time at a fixed angular speed, advanced by the
+ * time elapsed rather than by frames, so a solution takes as long on a
+ * 30 Hz display as on a 144 Hz one. Finished moves are handed back to be
+ * committed to the cube; the move still turning is only an angle.
+ *
+ * When pipelined, the time left over after a move finishes goes to the
+ * next one within the same frame, so moves follow each other without a
+ * pause and several may finish in one frame at high speeds. Otherwise
+ * every move starts on a new frame and its end position is shown at
+ * least once.
+ */
+class MoveQueue {
+public:
+    /*
+     * @param quarters_per_second: speed, a half turn takes two quarter turns
+     */
+    MoveQueue(float quarters_per_second = 4.0f): speed(quarters_per_second) {}
+
+    void setSpeed(float quarters_per_second){ speed = quarters_per_second; }
+    float getSpeed() const { return speed; }
+
+    void setPipelined(bool pipelined_){ pipelined = pipelined_; }
+    bool isPipelined() const { return pipelined; }
+
+    bool empty() const { return !turning && waiting.empty(); }
+
+    /*
+     * Queue moves behind the waiting ones. Waiting moves are merged &
+     * cancelled with the new ones, so wasted turns are never animated.
+     */
+    void push(const std::vector<Move>& moves, int rank){
+        MoveSimplifier simplifier(rank);
+        simplifier.push(std::vector<Move>(waiting.begin(), waiting.end()));
+        simplifier.push(moves);
+        std::vector<Move> merged = simplifier.moves();
+        waiting.assign(merged.begin(), merged.end());
+    }
+
+    /*
+     * Turn a layer left at some angle, e.g. by a mouse drag, on to the
+     * nearest quarter turn. It goes before every waiting move.
+     *
+     * @param angle: current angle of the layer, in degrees
+     */
+    void settle(RotateState axis, int layer, float angle){
+        if(turning) waiting.push_front(active.move);
+        float target = 90.0f * std::round(angle / 90.0f);
+        active = Step{Move(axis, layer, static_cast<int>(std::lround(target / 90.0f))), target};
+        this->angle = angle;
+        turning = axis != ROTATE_NONE && layer != LAYER_NONE;
+    }
+
+    /*
+     * Advance the animation by some time.
+     *
+     * @param finished: receives the moves that completed, to commit in order
+     */
+    void update(float delta_time, std::vector<Move>& finished){
+        float budget = 90.0f * speed * delta_time;
+        while(budget > 0 && !empty()){
+            if(!turning) start();
+            float remaining = std::fabs(active.target - angle);
+            if(budget < remaining){
+                angle += active.target < angle ? -budget : budget;
+                return;
+            }
+            budget -= remaining;
+            finished.push_back(active.move);
+            turning = false;
+            if(!pipelined) return;
+        }
+    }
+
+    /*
+     * The move turning right now and its angle in degrees.
+     *
+     * @return false if no move is turning
+     */
+    bool current(RotateState& axis, int& layer, float& angle) const {
+        if(!turning) return false;
+        axis = active.move.axis;
+        layer = active.move.layer;
+        angle = this->angle;
+        return true;
+    }
+
+    /*
+     * Skip the animation: every queued move, the turning one included, is
+     * handed back to be committed at once, e.g. through CompiledMoves.
+     */
+    void fastForward(std::vector<Move>& finished){
+        if(turning) finished.push_back(active.move);
+        finished.insert(finished.end(), waiting.begin(), waiting.end());
+        clear();
+    }
+
+    void clear(){
+        turning = false;
+        waiting.clear();
+    }
+
+private:
+    struct Step {
+        Move move;
+        float target;   // angle the move ends at, in degrees
+    };
+
+    float speed;
+    bool pipelined = false;
+    std::deque<Move> waiting;
+    Step active;
+    bool turning = false;
+    float angle = 0;
+
+    void start(){
+        const Move& move = waiting.front();
+        int quarters = ((move.quarters % 4) + 4) % 4;
+        // quarter turns are animated the short way round
+        active = Step{move, (quarters == 3 ? -1 : quarters) * 90.0f};
+        angle = 0;
+        turning = true;
+        waiting.pop_front();
+    }
+};
+
+#endif
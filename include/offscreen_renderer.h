@@ -0,0 +1,178 @@
+#ifndef OFFSCREEN_RENDERER_H_
+#define OFFSCREEN_RENDERER_H_
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "gl_resources.h"
+
+/*
+ * Render target for drawing without a visible window, e.g. thumbnails of
+ * many cube states in one GL context.
+ *
+ * Frames are drawn into a framebuffer object, multisampled if asked, and
+ * read back through a ring of pixel buffer objects: endFrame only queues
+ * the copy, and a frame is mapped a few frames later, once the GPU (or the
+ * software rasterizer) has long finished it. Drawing the next frames thus
+ * overlaps with reading back the previous ones. Frames come back in the
+ * order they were drawn.
+ */
+class OffscreenRenderer {
+public:
+    /*
+     * Create the framebuffers & pixel buffers, a GL context has to be current.
+     *
+     * @param samples: samples per pixel, 0 for no multisampling
+     * @param depth: # frames in flight before a readback has to wait
+     * @return false if the framebuffer is not complete
+     */
+    bool init(int width_, int height_, int samples = 4, int depth = 3){
+        width = width_;
+        height = height_;
+        resolveFBO = createTarget(0);
+        drawFBO = samples > 0 ? createTarget(samples) : resolveFBO;
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+        if(!resolveFBO || !drawFBO){
+            std::cerr << "Offscreen framebuffer is not complete" << std::endl;
+            release();
+            return false;
+        }
+
+        pbos.clear();
+        for(int ix = 0; ix != depth; ++ix){
+            pbos.push_back(resources.genBuffer());
+            glBindBuffer(GL_PIXEL_PACK_BUFFER, pbos.back());
+            glBufferData(GL_PIXEL_PACK_BUFFER, frameBytes(), NULL, GL_STREAM_READ);
+        }
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+        return true;
+    }
+
+    int getWidth() const { return width; }
+    int getHeight() const { return height; }
+
+    /*
+     * Bind the framebuffer & viewport and clear, then draw as usual.
+     */
+    void beginFrame(const glm::vec4& clear_color){
+        glBindFramebuffer(GL_FRAMEBUFFER, drawFBO);
+        glViewport(0, 0, width, height);
+        glClearColor(clear_color.r, clear_color.g, clear_color.b, clear_color.a);
+        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+    }
+
+    /*
+     * Queue the readback of the frame just drawn.
+     * Call popFrame first if full, the ring has no free pixel buffer then.
+     */
+    void endFrame(){
+        if(drawFBO != resolveFBO){
+            glBindFramebuffer(GL_READ_FRAMEBUFFER, drawFBO);
+            glBindFramebuffer(GL_DRAW_FRAMEBUFFER, resolveFBO);
+            glBlitFramebuffer(0, 0, width, height, 0, 0, width, height, GL_COLOR_BUFFER_BIT, GL_NEAREST);
+        }
+        glBindFramebuffer(GL_READ_FRAMEBUFFER, resolveFBO);
+        GLuint pbo = pbos[(first + queued) % pbos.size()];
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, pbo);
+        // RGBA rows are 4-byte aligned, the copy needs no repacking
+        glReadPixels(0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, (void*)0);
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+        ++queued;
+    }
+
+    bool full() const { return queued == pbos.size(); }
+    bool pending() const { return queued != 0; }
+
+    /*
+     * Take the oldest queued frame.
+     *
+     * @param rgb: receives width x height RGB pixels, top row first
+     * @return false if no frame is queued or the pixel buffer can not be mapped
+     */
+    bool popFrame(std::vector<std::uint8_t>& rgb){
+        if(!queued) return false;
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, pbos[first]);
+        const std::uint8_t* rgba = static_cast<const std::uint8_t*>(glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, frameBytes(), GL_MAP_READ_BIT));
+        first = (first + 1) % pbos.size();
+        --queued;
+        if(!rgba){
+            glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+            return false;
+        }
+
+        // GL rows start at the bottom
+        rgb.resize(std::size_t(3) * width * height);
+        for(int y = 0; y != height; ++y){
+            const std::uint8_t* src = rgba + std::size_t(4) * width * (height - 1 - y);
+            std::uint8_t* dst = rgb.data() + std::size_t(3) * width * y;
+            for(int x = 0; x != width; ++x){
+                dst[3 * x] = src[4 * x];
+                dst[3 * x + 1] = src[4 * x + 1];
+                dst[3 * x + 2] = src[4 * x + 2];
+            }
+        }
+        glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+        return true;
+    }
+
+    /*
+     * Release every GPU object, before the GL context is destroyed.
+     */
+    void release(){
+        resources.release();
+        pbos.clear();
+        first = queued = 0;
+        drawFBO = resolveFBO = 0;
+    }
+
+private:
+    GLResources resources;
+    int width = 0, height = 0;
+    GLuint drawFBO = 0, resolveFBO = 0;
+    std::vector<GLuint> pbos;
+    std::size_t first = 0, queued = 0;   // ring of pixel buffers, oldest queued frame first
+
+    std::size_t frameBytes() const { return std::size_t(4) * width * height; }
+
+    // framebuffer with color & depth renderbuffers, 0 if not complete
+    GLuint createTarget(int samples){
+        GLuint fbo = resources.genFramebuffer();
+        glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+        GLuint color = resources.genRenderbuffer(), depth = resources.genRenderbuffer();
+        glBindRenderbuffer(GL_RENDERBUFFER, color);
+        glRenderbufferStorageMultisample(GL_RENDERBUFFER, samples, GL_RGBA8, width, height);
+        glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, color);
+        glBindRenderbuffer(GL_RENDERBUFFER, depth);
+        glRenderbufferStorageMultisample(GL_RENDERBUFFER, samples, GL_DEPTH_COMPONENT24, width, height);
+        glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, depth);
+        glBindRenderbuffer(GL_RENDERBUFFER, 0);
+        return glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE ? fbo : 0;
+    }
+};
+
+/*
+ * Write RGB pixels, top row first, as a binary PPM image.
+ * PPM images can also be concatenated into one stream, e.g. on stdout.
+ */
+inline bool writePPM(FILE* file, int width, int height, const std::vector<std::uint8_t>& rgb){
+    return std::fprintf(file, "P6\n%d %d\n255\n", width, height) > 0 &&
+           std::fwrite(rgb.data(), 1, rgb.size(), file) == rgb.size();
+}
+
+inline bool writePPM(const std::string& path, int width, int height, const std::vector<std::uint8_t>& rgb){
+    FILE* file = std::fopen(path.c_str(), "wb");
+    if(!file) return false;
+    bool ok = writePPM(file, width, height, rgb);
+    return std::fclose(file) == 0 && ok;
+}
+
+#endif
@@ -0,0 +1,431 @@
+#ifndef PARALLEL_SEARCH_H_
+#define PARALLEL_SEARCH_H_
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "cubie_cube.h"
+#include "mapped_file.h"
+#include "thread_pool.h"
+#include "two_phase.h"
+
+/*
+ * This file contains searches spread over a ThreadPool. The tables they
+ * read are built beforehand and shared by every thread without locking.
+ */
+
+/*
+ * Pattern database of the corners: the exact number of face turns solving
+ * the corners of a cube, for all 8! * 3^7 = 88,179,840 corner states.
+ * Distances are packed two to a byte, 44 MB, and never exceed 11.
+ *
+ * Corners need 8.8 turns on average where the phase 1 tables of the
+ * two-phase solver give about 6, which is what makes optimal search
+ * practical. The table is built on a thread pool and kept in a file,
+ * memory-mapped like the two-phase tables.
+ */
+class CornerTable {
+public:
+    typedef CubeCoordinates C;
+    static const int NUM_MOVES = CubieCube::NUM_MOVES;
+    static const std::uint32_t VERSION = 1;
+    static const std::size_t SIZE = std::size_t(C::N_CPERM) * C::N_TWIST;
+
+    CornerTable(){
+        cperm_move.resize(C::N_CPERM * NUM_MOVES);
+        twist_move.resize(C::N_TWIST * NUM_MOVES);
+        fillMoveTable(cperm_move.data(), C::N_CPERM, C::setCornerPerm, C::getCornerPerm);
+        fillMoveTable(twist_move.data(), C::N_TWIST, C::setTwist, C::getTwist);
+    }
+
+    bool ready() const { return table != nullptr; }
+
+    int cpermMove(int cperm, int m) const { return cperm_move[cperm * NUM_MOVES + m]; }
+    int twistMove(int twist, int m) const { return twist_move[twist * NUM_MOVES + m]; }
+
+    // face turns solving the corners, index cperm * N_TWIST + twist
+    int distance(int cperm, int twist) const {
+        return TwoPhaseTables::distance(table, std::size_t(cperm) * C::N_TWIST + twist);
+    }
+
+    /*
+     * Build the table in memory.
+     */
+    void generate(ThreadPool& pool){
+        mapped.close();
+        owned.assign((SIZE + 1) / 2, 0);
+        build(owned.data(), pool);
+        table = owned.data();
+    }
+
+    /*
+     * Build the table and write it to path.
+     *
+     * @return false if the file can not be written, the table is built anyway
+     */
+    bool generate(const std::string& path, ThreadPool& pool){
+        generate(pool);
+        return save(path);
+    }
+
+    bool save(const std::string& path) const {
+        if(owned.empty()) return false;
+        FILE* file = std::fopen(path.c_str(), "wb");
+        if(!file) return false;
+        std::vector<std::uint8_t> block(HEADER_SIZE, 0);
+        Header header = makeHeader();
+        header.checksum = checksum(owned.data(), owned.size());
+        std::memcpy(block.data(), &header, sizeof(header));
+        bool ok = std::fwrite(block.data(), 1, block.size(), file) == block.size() &&
+                  std::fwrite(owned.data(), 1, owned.size(), file) == owned.size();
+        return std::fclose(file) == 0 && ok;
+    }
+
+    /*
+     * Memory-map a table saved by a previous run.
+     *
+     * @param verify: also check the checksum, which reads the whole file
+     * @return false if the file is missing, incomplete or of another version
+     */
+    bool load(const std::string& path, bool verify = false){
+        owned.clear();
+        owned.shrink_to_fit();
+        table = nullptr;
+        if(!mapped.open(path)) return false;
+
+        Header header, expected = makeHeader();
+        bool ok = mapped.size() == HEADER_SIZE + (SIZE + 1) / 2;
+        if(ok){
+            std::memcpy(&header, mapped.data(), sizeof(header));
+            ok = std::memcmp(&header, &expected, offsetof(Header, checksum)) == 0 &&
+                 (!verify || checksum(mapped.data() + HEADER_SIZE, (SIZE + 1) / 2) == header.checksum);
+        }
+        if(!ok){
+            mapped.close();
+            return false;
+        }
+        table = mapped.data() + HEADER_SIZE;
+        return true;
+    }
+
+    /*
+     * Load the table from path, or generate it there.
+     *
+     * @return false if the table had to be generated and could not be saved
+     */
+    bool loadOrGenerate(const std::string& path, ThreadPool& pool){
+        if(load(path)) return true;
+        return generate(path, pool);
+    }
+
+private:
+    struct Header {
+        char magic[8];
+        std::uint32_t version;
+        std::uint32_t num_moves;
+        std::uint64_t size;      // # corner states
+        std::uint64_t checksum;  // FNV-1a of the table
+    };
+
+    // the table starts on a page boundary
+    static const std::size_t HEADER_SIZE = 4096;
+    static const int CHUNK = 1 << 16;
+    static const std::uint8_t UNSEEN = 0xff;
+
+    std::vector<std::uint16_t> cperm_move;   // [N_CPERM][NUM_MOVES]
+    std::vector<std::uint16_t> twist_move;   // [N_TWIST][NUM_MOVES]
+    const std::uint8_t* table = nullptr;
+    std::vector<std::uint8_t> owned;
+    MappedFile mapped;
+
+    static Header makeHeader(){
+        Header header;
+        std::memset(&header, 0, sizeof(header));
+        std::memcpy(header.magic, "CORNERS", 8);
+        header.version = VERSION;
+        header.num_moves = NUM_MOVES;
+        header.size = SIZE;
+        return header;
+    }
+
+    static std::uint64_t checksum(const std::uint8_t* data, std::size_t size){
+        std::uint64_t hash = 14695981039346656037ull;
+        for(std::size_t ix = 0; ix != size; ++ix){
+            hash ^= data[ix];
+            hash *= 1099511628211ull;
+        }
+        return hash;
+    }
+
+    static void fillMoveTable(std::uint16_t* moves, int n, void (*set)(CubieCube&, int), int (*get)(const CubieCube&)){
+        for(int ix = 0; ix != n; ++ix){
+            CubieCube cube;
+            set(cube, ix);
+            for(int m = 0; m != NUM_MOVES; ++m){
+                CubieCube next = cube;
+                next.move(m);
+                moves[ix * NUM_MOVES + m] = static_cast<std::uint16_t>(get(next));
+            }
+        }
+    }
+
+    /*
+     * Breadth-first search, a byte per state first and packed at the end.
+     * Early levels are few states and expand forward; once most states are
+     * known, each unknown state instead looks for a neighbor on the last
+     * level, which stops at the first hit and only writes its own entry.
+     */
+    void build(std::uint8_t* packed, ThreadPool& pool) const {
+        std::vector<std::atomic<std::uint8_t>> dist(SIZE);
+        for(std::size_t ix = 0; ix != SIZE; ++ix) dist[ix].store(UNSEEN, std::memory_order_relaxed);
+        dist[0] = 0;
+
+        std::size_t known = 1, level = 1;
+        for(std::uint8_t depth = 0; known != SIZE && level != 0; ++depth){
+            bool backward = level * NUM_MOVES > SIZE - known;
+            std::atomic<std::size_t> added{0};
+            for(std::size_t first = 0; first < SIZE; first += CHUNK){
+                pool.submit([&, first, depth, backward]{
+                    std::size_t count = 0;
+                    for(std::size_t ix = first; ix != std::min(SIZE, first + CHUNK); ++ix){
+                        std::uint8_t d = dist[ix].load(std::memory_order_relaxed);
+                        if(backward ? d != UNSEEN : d != depth) continue;
+                        int cperm = static_cast<int>(ix / C::N_TWIST), twist = static_cast<int>(ix % C::N_TWIST);
+                        for(int m = 0; m != NUM_MOVES; ++m){
+                            std::size_t next = std::size_t(cpermMove(cperm, m)) * C::N_TWIST + twistMove(twist, m);
+                            if(backward){
+                                if(dist[next].load(std::memory_order_relaxed) != depth) continue;
+                                dist[ix].store(depth + 1, std::memory_order_relaxed);
+                                ++count;
+                                break;
+                            }
+                            std::uint8_t unseen = UNSEEN;
+                            if(dist[next].compare_exchange_strong(unseen, depth + 1, std::memory_order_relaxed))
+                                ++count;
+                        }
+                    }
+                    added += count;
+                });
+            }
+            pool.wait();
+            level = added;
+            known += level;
+        }
+
+        std::memset(packed, 0, (SIZE + 1) / 2);
+        for(std::size_t ix = 0; ix != SIZE; ++ix){
+            int d = dist[ix].load(std::memory_order_relaxed);
+            packed[ix >> 1] |= (d > 0xf ? 0xf : d) << ((ix & 1) << 2);
+        }
+    }
+};
+
+/*
+ * Optimal (fewest face turns) 3x3x3 solver, IDA* bounded by the corner
+ * pattern database and the phase 1 pruning tables of the two-phase solver,
+ * whichever is larger.
+ *
+ * Each iteration expands the search tree on the calling thread down to
+ * split_depth and hands every remaining subtree to the pool as one task.
+ * Subtrees differ wildly in size, work stealing keeps the threads busy.
+ * Scrambles of up to about 16 turns take seconds to minutes; a random
+ * state, 18 turns from solved on average, can take hours.
+ */
+class OptimalSolver {
+public:
+    OptimalSolver(const TwoPhaseTables& tables_, const CornerTable& corners_, ThreadPool& pool_, int split_depth_ = 3):
+        tables(tables_), corners(corners_), pool(pool_), split_depth(split_depth_) {}
+
+    /*
+     * @param cube: cube to solve
+     * @param solution: face turns (CubieCube numbering) solving the cube
+     * @param max_length: give up on solutions longer than this
+     * @return false if the cube is not solvable within max_length
+     */
+    bool solve(const CubieCube& cube, std::vector<int>& solution, int max_length = 20){
+        solution.clear();
+        if(!CubeCoordinates::solvable(cube)) return false;
+
+        Node root = {cube, CubeCoordinates::getCornerPerm(cube), CubeCoordinates::getTwist(cube),
+                     CubeCoordinates::getFlip(cube), CubeCoordinates::getSlice(cube)};
+        std::vector<int> path;
+        nodes = 0;
+        for(int bound = lowerBound(root); bound <= std::min(max_length, MAX_LENGTH); ++bound){
+            found = false;
+            split(root, 0, bound, -1, path);
+            pool.wait();
+            if(found){
+                solution = best;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // nodes visited by the last solve
+    std::uint64_t visited() const { return nodes; }
+
+private:
+    static const int MAX_LENGTH = 30;
+    static const int NUM_MOVES = CubieCube::NUM_MOVES;
+
+    struct Node {
+        CubieCube cube;
+        int cperm, twist, flip, slice;
+    };
+
+    const TwoPhaseTables& tables;
+    const CornerTable& corners;
+    ThreadPool& pool;
+    int split_depth;
+    std::atomic<bool> found{false};
+    std::atomic<std::uint64_t> nodes{0};
+    std::mutex best_mutex;
+    std::vector<int> best;
+
+    // lower bound of the distance to solved: the corners, and reaching phase 2
+    int lowerBound(const Node& node) const {
+        int a = corners.distance(node.cperm, node.twist);
+        int b = TwoPhaseTables::distance(tables.slice_twist_prune, node.slice * CubeCoordinates::N_TWIST + node.twist);
+        int c = TwoPhaseTables::distance(tables.slice_flip_prune, node.slice * CubeCoordinates::N_FLIP + node.flip);
+        return std::max(a, std::max(b, c));
+    }
+
+    // lowerBound(node) <= moves_left, the small phase 1 tables are checked
+    // first and mostly spare the cache miss on the corner table
+    bool within(const Node& node, int moves_left) const {
+        return TwoPhaseTables::distance(tables.slice_twist_prune, node.slice * CubeCoordinates::N_TWIST + node.twist) <= moves_left &&
+               TwoPhaseTables::distance(tables.slice_flip_prune, node.slice * CubeCoordinates::N_FLIP + node.flip) <= moves_left &&
+               corners.distance(node.cperm, node.twist) <= moves_left;
+    }
+
+    Node child(const Node& node, int m) const {
+        Node next = {node.cube, corners.cpermMove(node.cperm, m), tables.twist_move[node.twist * NUM_MOVES + m],
+                     tables.flip_move[node.flip * NUM_MOVES + m], tables.slice_move[node.slice * NUM_MOVES + m]};
+        next.cube.move(m);
+        return next;
+    }
+
+    void split(const Node& node, int depth, int bound, int last, std::vector<int>& path){
+        if(found) return;
+        if(depth == split_depth || depth == bound){
+            std::vector<int> prefix = path;
+            pool.submit([this, node, depth, bound, last, prefix]{
+                int moves[MAX_LENGTH];
+                std::copy(prefix.begin(), prefix.end(), moves);
+                std::uint64_t count = 0;
+                bool solved = search(node, depth, bound, last, moves, count);
+                nodes += count;
+                if(solved){
+                    std::lock_guard<std::mutex> lock(best_mutex);
+                    if(!found.exchange(true)) best.assign(moves, moves + bound);
+                }
+            });
+            return;
+        }
+        for(int m = 0; m != NUM_MOVES; ++m){
+            if(TwoPhaseSolver::redundant(m, last)) continue;
+            Node next = child(node, m);
+            if(!within(next, bound - depth - 1)) continue;
+            path.push_back(m);
+            split(next, depth + 1, bound, m, path);
+            path.pop_back();
+        }
+    }
+
+    bool search(const Node& node, int depth, int bound, int last, int* moves, std::uint64_t& count) const {
+        ++count;
+        if(depth == bound) return node.cube.solved();
+        if(found.load(std::memory_order_relaxed)) return false;
+        for(int m = 0; m != NUM_MOVES; ++m){
+            if(TwoPhaseSolver::redundant(m, last)) continue;
+            Node next = child(node, m);
+            if(!within(next, bound - depth - 1)) continue;
+            moves[depth] = m;
+            if(search(next, depth + 1, bound, m, moves, count)) return true;
+        }
+        return false;
+    }
+};
+
+/*
+ * Breadth-first enumeration of every 2x2x2 state, which behaves like the
+ * corners of a 3x3x3 turned by U, R and F only (the back-left-bottom corner
+ * stays put). Each level of the search is cut into chunks run on the pool;
+ * states are marked in a shared bitmap with atomic or.
+ *
+ * @param quarter_turns: count quarter turns only instead of face turns
+ * @return number of states at each distance from solved, the last
+ *         distance is God's number of the 2x2x2
+ */
+inline std::vector<std::uint64_t> enumerateCube2(ThreadPool& pool, bool quarter_turns = false){
+    typedef CubeCoordinates C;
+    const int NUM_MOVES = 9; // U, R & F turns
+    const std::size_t CHUNK = 1 << 14;
+
+    std::vector<int> moves;
+    for(int m = 0; m != NUM_MOVES; ++m)
+        if(!quarter_turns || m % 3 != 1) moves.push_back(m);
+
+    std::vector<std::uint16_t> cperm_move(C::N_CPERM * NUM_MOVES), twist_move(C::N_TWIST * NUM_MOVES);
+    for(int ix = 0; ix != C::N_CPERM; ++ix){
+        CubieCube cube;
+        C::setCornerPerm(cube, ix);
+        for(int m : moves){
+            CubieCube next = cube;
+            next.move(m);
+            cperm_move[ix * NUM_MOVES + m] = C::getCornerPerm(next);
+        }
+    }
+    for(int ix = 0; ix != C::N_TWIST; ++ix){
+        CubieCube cube;
+        C::setTwist(cube, ix);
+        for(int m : moves){
+            CubieCube next = cube;
+            next.move(m);
+            twist_move[ix * NUM_MOVES + m] = C::getTwist(next);
+        }
+    }
+
+    // state index cperm * N_TWIST + twist
+    const std::size_t n = std::size_t(C::N_CPERM) * C::N_TWIST;
+    std::vector<std::atomic<std::uint64_t>> visited(n / 64 + 1);
+    visited[0] |= 1;
+
+    std::vector<std::uint64_t> counts;
+    std::vector<std::uint32_t> frontier(1, 0);
+    while(!frontier.empty()){
+        counts.push_back(frontier.size());
+        std::vector<std::vector<std::uint32_t>> found((frontier.size() + CHUNK - 1) / CHUNK);
+        for(std::size_t chunk = 0; chunk != found.size(); ++chunk){
+            pool.submit([&, chunk]{
+                std::vector<std::uint32_t>& next = found[chunk];
+                std::size_t end = std::min(frontier.size(), (chunk + 1) * CHUNK);
+                for(std::size_t ix = chunk * CHUNK; ix != end; ++ix){
+                    int cperm = frontier[ix] / C::N_TWIST, twist = frontier[ix] % C::N_TWIST;
+                    for(int m : moves){
+                        std::uint32_t state = cperm_move[cperm * NUM_MOVES + m] * C::N_TWIST + twist_move[twist * NUM_MOVES + m];
+                        std::uint64_t bit = std::uint64_t(1) << (state % 64);
+                        if(visited[state / 64].load(std::memory_order_relaxed) & bit) continue;
+                        if(!(visited[state / 64].fetch_or(bit) & bit)) next.push_back(state);
+                    }
+                }
+            });
+        }
+        pool.wait();
+
+        frontier.clear();
+        for(const std::vector<std::uint32_t>& next : found)
+            frontier.insert(frontier.end(), next.begin(), next.end());
+    }
+    return counts;
+}
+
+#endif
@@ -5,6 +5,8 @@
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtc/type_ptr.hpp>
 
+#include <utility>
+
 class Ray{
 public:
     glm::vec3 origin;
@@ -19,5 +21,44 @@ public:
     }
 };
 
+/*
+ * Axis aligned bounding box, intersected with the slab method.
+ */
+class AABB{
+public:
+    glm::vec3 lo;
+    glm::vec3 hi;
+
+    AABB() = default;
+    AABB(const glm::vec3& lo_, const glm::vec3& hi_):
+        lo(lo_), hi(hi_) {}
+
+    /*
+     * @param t: distance to the entry point, set on hit
+     * @param axis: axis of the plane the ray enters through, set on hit
+     */
+    bool hit(const Ray& ray, float t_min, float t_max, float& t, int& axis) const {
+        int entry_axis = -1;
+        for(int a = 0; a != 3; ++a){
+            // a zero direction gives infinities, which the comparisons below handle
+            float inv = 1.0f / ray.direction[a];
+            float t0 = (lo[a] - ray.origin[a]) * inv;
+            float t1 = (hi[a] - ray.origin[a]) * inv;
+            if(inv < 0) std::swap(t0, t1);
+            if(t0 > t_min){
+                t_min = t0;
+                entry_axis = a;
+            }
+            if(t1 < t_max) t_max = t1;
+            if(t_max < t_min) return false;
+        }
+        // a ray starting inside the box has no entry point
+        if(entry_axis < 0) return false;
+        t = t_min;
+        axis = entry_axis;
+        return true;
+    }
+};
+
 #endif
 
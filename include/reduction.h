@@ -0,0 +1,554 @@
+#ifndef REDUCTION_H_
+#define REDUCTION_H_
+
+#include <cstdlib>
+#include <vector>
+
+#include "cube_state.h"
+#include "cube_moves.h"
+#include "cubie_cube.h"
+#include "two_phase.h"
+
+/*
+ * This file contains a solver for cubes of any rank, reducing them to a 3x3x3:
+ *
+ *   1. wing parity: a single inner slice turn makes every wing orbit an even permutation
+ *   2. centers:     3-cycles inside each center orbit bring the right colors to every face
+ *   3. 3x3x3:       the two-phase solver solves corners (and middle edges of odd ranks)
+ *   4. wings:       3-cycles inside each wing orbit pair up the edges
+ *
+ * Pieces of steps 2 and 4 are solved one by one with pure commutators,
+ * so the number of moves and the running time grow linearly with the
+ * number of pieces.
+ */
+
+/*
+ * 3-cycles of one kind of piece orbit, worked out once on a small representative cube.
+ *
+ * An orbit is the set of 24 positions a piece can reach. Positions are
+ * given by centered coordinates (doubled, see CubeState::turn), which only
+ * take the values +-u, +-v of the orbit, +-(rank-1) of the faces and 0.
+ * Mapping these values keeps orbits of different cubes in step, together
+ * with the moves of layers at those coordinates. The representative cubes
+ * are large enough to hold pieces with coordinates outside the orbit, which
+ * keeps the commutators pure on cubes of every rank.
+ */
+class OrbitCycles {
+public:
+    enum Kind {X_CENTER, OBLIQUE_LEFT, OBLIQUE_RIGHT, PLUS_CENTER, WING, NUM_KINDS};
+    static const int SIZE = 24;
+
+    static const OrbitCycles& get(Kind kind){
+        static const OrbitCycles cycles[NUM_KINDS] = {
+            OrbitCycles(X_CENTER), OrbitCycles(OBLIQUE_LEFT), OrbitCycles(OBLIQUE_RIGHT),
+            OrbitCycles(PLUS_CENTER), OrbitCycles(WING)
+        };
+        return cycles[kind];
+    }
+
+    const CubeState& getCube() const { return cube; }
+
+    // |u| and |v| of the representative orbit
+    int getMagnitude(int ix) const { return magnitude[ix]; }
+
+    // facelets of a position, one for centers and two for wings
+    int faceletsPerPosition() const { return per_position; }
+    int facelet(int pos, int k) const { return positions[pos * per_position + k]; }
+
+    /*
+     * Moves of the representative cube cycling the pieces at positions
+     * a -> b -> c, touching nothing else.
+     */
+    void cycle(int a, int b, int c, std::vector<Move>& moves) const {
+        std::vector<int> path;
+        int ix = tripleIndex(a, b, c);
+        while(triples[ix].parent >= 0){
+            path.push_back(triples[ix].generator);
+            ix = triples[ix].parent;
+        }
+        for(int g : path) moves.push_back(inverse(generators[g]));
+        if(triples[ix].root == 0) moves.insert(moves.end(), base.begin(), base.end());
+        else{
+            for(int k = static_cast<int>(base.size()) - 1; k >= 0; --k) moves.push_back(inverse(base[k]));
+        }
+        for(int k = static_cast<int>(path.size()) - 1; k >= 0; --k) moves.push_back(generators[path[k]]);
+    }
+
+private:
+    struct Triple {
+        int parent;
+        short generator;
+        short root;
+    };
+
+    CubeState cube;
+    int magnitude[2];
+    int per_position;
+    std::vector<int> positions;
+    std::vector<int> position_of;
+    std::vector<Move> generators;
+    std::vector<std::vector<int>> generator_perms;
+    std::vector<Move> base;
+    int base_triple[3];
+    std::vector<Triple> triples;
+
+    explicit OrbitCycles(Kind kind){
+        // representative rank, reference position and its |u|, |v|
+        int rank = 8, ref_i = 1, ref_j = 1;
+        switch(kind){
+            case X_CENTER:      rank = 8;  ref_i = 1; ref_j = 1; break;
+            case OBLIQUE_LEFT:  rank = 10; ref_i = 1; ref_j = 2; break;
+            case OBLIQUE_RIGHT: rank = 10; ref_i = 2; ref_j = 1; break;
+            case PLUS_CENTER:   rank = 9;  ref_i = 1; ref_j = 4; break;
+            case WING:          rank = 8;  ref_i = 1; ref_j = 1; break;
+            default: break;
+        }
+        cube.reset(rank);
+        magnitude[0] = std::abs(2 * ref_i - (rank - 1));
+        magnitude[1] = std::abs(2 * ref_j - (rank - 1));
+
+        // only layers at coordinates an orbit of any rank also has
+        for(int axis = 0; axis != 3; ++axis){
+            for(int layer = 0; layer != rank; ++layer){
+                int c = std::abs(2 * layer - (rank - 1));
+                if(c != rank - 1 && c != magnitude[0] && c != magnitude[1]) continue;
+                for(int q = 1; q != 4; ++q) generators.emplace_back(RotateState(axis), layer, q);
+            }
+        }
+        for(const Move& g : generators){
+            std::vector<int> perm(cube.numFacelets());
+            for(int ix = 0; ix != cube.numFacelets(); ++ix) perm[ix] = cube.turnedFacelet(ix, g.axis, g.layer, g.quarters);
+            generator_perms.push_back(perm);
+        }
+
+        // positions reachable from the reference, wings keep the order of their two facelets
+        std::vector<int> ref;
+        if(kind == WING){
+            per_position = 2;
+            ref.push_back(cube.faceletIndex(FACE_FRONT, rank - 1, ref_j));
+            ref.push_back(cube.faceletIndex(FACE_TOP, 0, ref_j));
+        }
+        else{
+            per_position = 1;
+            ref.push_back(cube.faceletIndex(FACE_FRONT, ref_i, ref_j));
+        }
+        position_of.assign(cube.numFacelets(), -1);
+        addPosition(ref.data());
+        for(int pos = 0; pos != static_cast<int>(positions.size()) / per_position; ++pos){
+            for(const std::vector<int>& perm : generator_perms){
+                int next[2];
+                for(int k = 0; k != per_position; ++k) next[k] = perm[facelet(pos, k)];
+                if(position_of[next[0]] < 0) addPosition(next);
+            }
+        }
+
+        findBase();
+        searchTriples();
+    }
+
+    void addPosition(const int* facelets){
+        position_of[facelets[0]] = static_cast<int>(positions.size()) / per_position;
+        for(int k = 0; k != per_position; ++k) positions.push_back(facelets[k]);
+    }
+
+    static Move inverse(const Move& m){ return Move(m.axis, m.layer, -m.quarters); }
+
+    static int tripleIndex(int a, int b, int c){ return (a * SIZE + b) * SIZE + c; }
+
+    std::vector<int> permutation(const std::vector<Move>& moves) const {
+        std::vector<int> perm(cube.numFacelets());
+        for(int ix = 0; ix != cube.numFacelets(); ++ix){
+            int jx = ix;
+            for(const Move& m : moves) jx = cube.turnedFacelet(jx, m.axis, m.layer, m.quarters);
+            perm[ix] = jx;
+        }
+        return perm;
+    }
+
+    /*
+     * Search commutators [X, A B A'] of single turns for one that is a
+     * pure 3-cycle of the orbit: X turns an inner layer and A a face.
+     */
+    void findBase(){
+        const int rank = cube.getRank();
+        for(const Move& x : generators){
+            if(x.quarters == 2 || x.layer == 0 || x.layer == rank - 1) continue;
+            for(const Move& a : generators){
+                if(a.quarters == 2 || (a.layer != 0 && a.layer != rank - 1) || a.axis == x.axis) continue;
+                for(const Move& b : generators){
+                    if(b.quarters == 2 || b.axis == a.axis) continue;
+                    std::vector<Move> seq = {x, a, b, inverse(a), inverse(x), a, inverse(b), inverse(a)};
+                    std::vector<int> perm = permutation(seq);
+                    int moved = 0, first = -1;
+                    for(int ix = 0; ix != cube.numFacelets(); ++ix){
+                        if(perm[ix] == ix) continue;
+                        ++moved;
+                        if(first < 0 && position_of[ix] >= 0) first = ix;
+                    }
+                    if(moved != 3 * per_position || first < 0) continue;
+
+                    // the moved facelets have to be those of three positions cycling
+                    int t[4] = {position_of[first]};
+                    bool pure = true;
+                    for(int n = 1; n != 4 && pure; ++n){
+                        t[n] = position_of[perm[facelet(t[n - 1], 0)]];
+                        pure = t[n] >= 0;
+                        for(int k = 0; k != per_position && pure; ++k)
+                            pure = perm[facelet(t[n - 1], k)] == facelet(t[n], k);
+                    }
+                    if(!pure || t[3] != t[0]) continue;
+                    base = seq;
+                    for(int n = 0; n != 3; ++n) base_triple[n] = t[n];
+                    return;
+                }
+            }
+        }
+    }
+
+    /*
+     * Breadth first search over conjugates of the base commutator and its
+     * inverse: turning the cycled positions by a generator g, the sequence
+     * g' C g cycles the turned positions.
+     */
+    void searchTriples(){
+        triples.assign(SIZE * SIZE * SIZE, Triple{-2, -1, -1});
+        std::vector<int> queue;
+        const int* t = base_triple;
+        const int roots[6][3] = {{t[0], t[1], t[2]}, {t[1], t[2], t[0]}, {t[2], t[0], t[1]},
+                                 {t[0], t[2], t[1]}, {t[2], t[1], t[0]}, {t[1], t[0], t[2]}};
+        for(int r = 0; r != 6; ++r){
+            int ix = tripleIndex(roots[r][0], roots[r][1], roots[r][2]);
+            triples[ix] = Triple{-1, -1, static_cast<short>(r / 3)};
+            queue.push_back(ix);
+        }
+
+        std::vector<std::vector<int>> position_perms;
+        for(const std::vector<int>& perm : generator_perms){
+            std::vector<int> p(SIZE);
+            for(int pos = 0; pos != SIZE; ++pos) p[pos] = position_of[perm[facelet(pos, 0)]];
+            position_perms.push_back(p);
+        }
+
+        for(std::size_t head = 0; head != queue.size(); ++head){
+            int ix = queue[head];
+            int a = ix / (SIZE * SIZE), b = ix / SIZE % SIZE, c = ix % SIZE;
+            for(int g = 0; g != static_cast<int>(generators.size()); ++g){
+                const std::vector<int>& p = position_perms[g];
+                int jx = tripleIndex(p[a], p[b], p[c]);
+                if(triples[jx].parent != -2) continue;
+                triples[jx] = Triple{ix, static_cast<short>(g), triples[ix].root};
+                queue.push_back(jx);
+            }
+        }
+    }
+};
+
+/*
+ * Solver for cubes of any rank, see the top of this file.
+ * The 3x3x3 stage needs the two-phase tables to be ready.
+ */
+class ReductionSolver {
+public:
+    ReductionSolver(const TwoPhaseTables& tables_): tables(tables_) {}
+
+    /*
+     * @param state: state to solve, of any rank
+     * @param moves: solution as moves of the state
+     * @return false if the state is not a solvable cube
+     */
+    bool solve(const CubeState& state, std::vector<Move>& moves){
+        cube = state;
+        rank = state.getRank();
+        solution = &moves;
+        moves.clear();
+
+        if(!findTargets() || !fixWingParity() || !solveCenters() || !solveCorners() || !solveWings()){
+            moves.clear();
+            return false;
+        }
+        // commutators of neighbouring pieces often undo each other's last turns
+        moves = simplifyMoves(moves, rank);
+        return cube.solved();
+    }
+
+private:
+    struct Orbit {
+        OrbitCycles::Kind kind;
+        int magnitude[2];
+        std::vector<int> facelets;
+    };
+
+    const TwoPhaseTables& tables;
+    CubeState cube;
+    int rank;
+    std::vector<Move>* solution;
+    FaceTexture targets[6];
+
+    /*
+     * Color of every face once solved: given by the middle centers of odd
+     * ranks, and by the corners around the back-left-bottom one otherwise.
+     */
+    bool findTargets(){
+        if(rank % 2 == 1){
+            for(int f = 0; f != 6; ++f) targets[f] = cube.facelet(Face(f), rank / 2, rank / 2);
+        }
+        else{
+            bool adjacent[7][7] = {};
+            for(int corner = 0; corner != 8; ++corner){
+                int x = corner & 1 ? rank - 1 : 0, y = corner & 2 ? rank - 1 : 0, z = corner & 4 ? rank - 1 : 0;
+                FaceTexture col[3] = {cube.cubieFace(x, y, z, x ? FACE_RIGHT : FACE_LEFT),
+                                      cube.cubieFace(x, y, z, y ? FACE_TOP : FACE_BUTTOM),
+                                      cube.cubieFace(x, y, z, z ? FACE_BACK : FACE_FRONT)};
+                for(int k = 0; k != 3; ++k){
+                    adjacent[col[k]][col[(k + 1) % 3]] = true;
+                    adjacent[col[(k + 1) % 3]][col[k]] = true;
+                }
+            }
+            const Face known[3] = {FACE_LEFT, FACE_BUTTOM, FACE_BACK};
+            const Face opposite[3] = {FACE_RIGHT, FACE_TOP, FACE_FRONT};
+            for(int k = 0; k != 3; ++k){
+                targets[known[k]] = cube.cubieFace(0, 0, rank - 1, known[k]);
+                int found = 0;
+                for(int col = FACE_TEXTURE_1; col <= FACE_TEXTURE_6; ++col){
+                    if(col == targets[known[k]] || adjacent[targets[known[k]]][col]) continue;
+                    targets[opposite[k]] = FaceTexture(col);
+                    ++found;
+                }
+                if(found != 1) return false;
+            }
+        }
+
+        // every color has to show up rank x rank times
+        int count[7] = {};
+        for(int ix = 0; ix != cube.numFacelets(); ++ix) ++count[cube.facelet(ix)];
+        for(int f = 0; f != 6; ++f){
+            for(int g = 0; g != f; ++g)
+                if(targets[f] == targets[g]) return false;
+            if(count[targets[f]] != rank * rank) return false;
+        }
+        return true;
+    }
+
+    void emit(const Move& move){
+        solution->push_back(move);
+        applyMove(cube, move);
+    }
+
+    // coordinate of the orbit for a coordinate of its representative
+    int mapCoordinate(const Orbit& orbit, int c) const {
+        const OrbitCycles& cycles = OrbitCycles::get(orbit.kind);
+        int sign = c < 0 ? -1 : 1, m = std::abs(c);
+        if(m == 0) return 0;
+        if(m == cycles.getCube().getRank() - 1) return sign * (rank - 1);
+        return sign * (m == cycles.getMagnitude(0) ? orbit.magnitude[0] : orbit.magnitude[1]);
+    }
+
+    Orbit makeOrbit(OrbitCycles::Kind kind, int u, int v) const {
+        Orbit orbit;
+        orbit.kind = kind;
+        orbit.magnitude[0] = u;
+        orbit.magnitude[1] = v;
+        const OrbitCycles& cycles = OrbitCycles::get(kind);
+        const CubeState& rep = cycles.getCube();
+        const int rep_rank = rep.getRank();
+        for(int pos = 0; pos != OrbitCycles::SIZE; ++pos){
+            for(int k = 0; k != cycles.faceletsPerPosition(); ++k){
+                Face f = FACE_BACK;
+                int g[3] = {0, 0, 0};
+                rep.faceletGrid(cycles.facelet(pos, k), f, g);
+                for(int axis = 0; axis != 3; ++axis)
+                    g[axis] = (mapCoordinate(orbit, 2 * g[axis] - (rep_rank - 1)) + rank - 1) / 2;
+                orbit.facelets.push_back(cube.faceletIndex(f, g));
+            }
+        }
+        return orbit;
+    }
+
+    /*
+     * Cycle the pieces at positions a -> b -> c of an orbit.
+     * The commutators are pure, so only those pieces are updated.
+     */
+    void cycle(const Orbit& orbit, int a, int b, int c){
+        const OrbitCycles& cycles = OrbitCycles::get(orbit.kind);
+        const int rep_rank = cycles.getCube().getRank();
+        std::vector<Move> moves;
+        cycles.cycle(a, b, c, moves);
+        for(const Move& m : moves){
+            int layer = (mapCoordinate(orbit, 2 * m.layer - (rep_rank - 1)) + rank - 1) / 2;
+            solution->emplace_back(m.axis, layer, m.quarters);
+        }
+
+        const int per = cycles.faceletsPerPosition();
+        for(int k = 0; k != per; ++k){
+            const int* f = orbit.facelets.data();
+            FaceTexture moved = cube.facelet(f[c * per + k]);
+            cube.setFacelet(f[c * per + k], cube.facelet(f[b * per + k]));
+            cube.setFacelet(f[b * per + k], cube.facelet(f[a * per + k]));
+            cube.setFacelet(f[a * per + k], moved);
+        }
+    }
+
+    // color the facelet at index ix has once solved, facelets are stored face by face
+    FaceTexture target(int ix) const {
+        return targets[ix / (rank * rank)];
+    }
+
+    /*
+     * Wing orbits hold the wings of layer k and rank-1-k, 0 < k < rank/2 - 1/2.
+     * home[pos] is the position the wing at pos belongs to.
+     */
+    bool wingHomes(const Orbit& orbit, int* home) const {
+        const int* f = orbit.facelets.data();
+        int found = 0;
+        for(int pos = 0; pos != OrbitCycles::SIZE; ++pos){
+            home[pos] = -1;
+            for(int h = 0; h != OrbitCycles::SIZE; ++h){
+                if(cube.facelet(f[2 * pos]) == target(f[2 * h]) && cube.facelet(f[2 * pos + 1]) == target(f[2 * h + 1]))
+                    home[pos] = h;
+            }
+            if(home[pos] < 0 || (found & (1 << home[pos]))) return false;
+            found |= 1 << home[pos];
+        }
+        return true;
+    }
+
+    std::vector<Orbit> wingOrbits() const {
+        std::vector<Orbit> orbits;
+        for(int k = 1; 2 * k < rank - 1; ++k){
+            int u = rank - 1 - 2 * k;
+            orbits.push_back(makeOrbit(OrbitCycles::WING, u, u));
+        }
+        return orbits;
+    }
+
+    /*
+     * An odd wing orbit can not be solved by 3-cycles. A quarter turn of
+     * its inner layer is an odd permutation of it and only moves centers else.
+     */
+    bool fixWingParity(){
+        for(const Orbit& orbit : wingOrbits()){
+            int home[OrbitCycles::SIZE];
+            if(!wingHomes(orbit, home)) return false;
+            int parity = 0;
+            bool seen[OrbitCycles::SIZE] = {};
+            for(int pos = 0; pos != OrbitCycles::SIZE; ++pos){
+                for(int ix = pos; !seen[ix]; ix = home[ix]){
+                    seen[ix] = true;
+                    if(home[ix] != pos) parity ^= 1;
+                }
+            }
+            if(parity) emit(Move(ROTATE_X, (rank - 1 - orbit.magnitude[0]) / 2, 1));
+        }
+        return true;
+    }
+
+    /*
+     * Center orbits are taken from the bottom-left quarter of the front face.
+     * Every position of an orbit wants the color of its face; colors show up
+     * 4 times in an orbit, so any arrangement is solved by 3-cycles.
+     */
+    bool solveCenters(){
+        for(int i = 1; 2 * i < rank - 1; ++i){
+            for(int j = 1; 2 * j <= rank - 1; ++j){
+                int u = rank - 1 - 2 * i, v = rank - 1 - 2 * j;
+                OrbitCycles::Kind kind = v == 0 ? OrbitCycles::PLUS_CENTER :
+                                         u == v ? OrbitCycles::X_CENTER :
+                                         u > v  ? OrbitCycles::OBLIQUE_LEFT : OrbitCycles::OBLIQUE_RIGHT;
+                if(!solveCenterOrbit(makeOrbit(kind, u, v))) return false;
+            }
+        }
+        return true;
+    }
+
+    bool solveCenterOrbit(const Orbit& orbit){
+        const int N = OrbitCycles::SIZE;
+        const int* f = orbit.facelets.data();
+        auto wrong = [&](int pos){ return cube.facelet(f[pos]) != target(f[pos]); };
+
+        // every 3-cycle solves at least one more position and breaks none
+        for(int step = 0; step <= N; ++step){
+            int p = 0;
+            while(p != N && !wrong(p)) ++p;
+            if(p == N) return true;
+            FaceTexture want = target(f[p]), have = cube.facelet(f[p]);
+
+            int q = 0;
+            while(q != N && !(cube.facelet(f[q]) == want && wrong(q))) ++q;
+            if(q == N) return false;
+
+            // where the piece leaving p goes: best a position wanting it, else any unsolved one
+            int r = -1;
+            for(int pos = 0; pos != N; ++pos){
+                if(pos == p || pos == q) continue;
+                if(wrong(pos) && target(f[pos]) == have){ r = pos; break; }
+                if(wrong(pos) && (r < 0 || !wrong(r))) r = pos;
+                if(r < 0 && target(f[pos]) == have) r = pos;
+            }
+            if(r < 0) return false;
+            cycle(orbit, q, p, r);
+        }
+        return false;
+    }
+
+    /*
+     * Solve the cube made of the corners, the middle edges of odd ranks and
+     * the face colors as a 3x3x3. Even ranks have no middle edges; they get
+     * solved ones, with two swapped if the corners are an odd permutation.
+     */
+    bool solveCorners(){
+        CubeState small(3);
+        const int middle[3] = {0, rank / 2, rank - 1};
+        for(int ix = 0; ix != small.numFacelets(); ++ix){
+            Face f = FACE_BACK;
+            int g[3] = {0, 0, 0}, inner = 0;
+            small.faceletGrid(ix, f, g);
+            for(int axis = 0; axis != 3; ++axis){
+                inner += g[axis] == 1;
+                g[axis] = middle[g[axis]];
+            }
+            bool known = inner == 0 || rank % 2 == 1;
+            small.setFacelet(ix, known ? cube.facelet(cube.faceletIndex(f, g)) : targets[f]);
+        }
+
+        CubieCube cubie;
+        if(!CubieCube::fromState(small, cubie)) return false;
+        if(rank % 2 == 0 && !CubeCoordinates::solvable(cubie)){
+            // swap the up-front and up-right edges
+            int front = small.faceletIndex(FACE_FRONT, 2, 1), right = small.faceletIndex(FACE_RIGHT, 2, 1);
+            FaceTexture t = small.facelet(front);
+            small.setFacelet(front, small.facelet(right));
+            small.setFacelet(right, t);
+        }
+
+        std::vector<Move> moves;
+        if(!solveState(tables, small, moves)) return false;
+        for(const Move& m : moves)
+            emit(Move(m.axis, m.layer == 2 ? rank - 1 : m.layer, m.quarters));
+        return true;
+    }
+
+    bool solveWings(){
+        const int N = OrbitCycles::SIZE;
+        for(const Orbit& orbit : wingOrbits()){
+            int home[N];
+            for(int step = 0; ; ++step){
+                if(!wingHomes(orbit, home) || step > N) return false;
+                int p = 0;
+                while(p != N && home[p] == p) ++p;
+                if(p == N) break;
+
+                // bring the wing of p home, its own wing goes home if that is free
+                int q = 0;
+                while(home[q] != p) ++q;
+                int r = home[p] != q ? home[p] : -1;
+                for(int pos = 0; pos != N && r < 0; ++pos)
+                    if(pos != p && pos != q && home[pos] != pos) r = pos;
+                if(r < 0) return false;
+                cycle(orbit, q, p, r);
+            }
+        }
+        return true;
+    }
+};
+
+#endif
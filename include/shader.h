@@ -6,6 +6,7 @@
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtc/type_ptr.hpp>
 #include <iostream>
+#include <unordered_map>
 
 #include <glad/glad.h>
 
@@ -84,68 +85,153 @@ public:
 		// Delete the shaders as they're linked into our program now and no longer necessery
 		glDeleteShader(vertex);
 		glDeleteShader(fragment);
-
+		// 3. Cache the location of every active uniform
+		cacheUniformLocations();
 	}
 	// Uses the current shader
 	void Use(){
 		glUseProgram(this->Program);
 	}
+	// Location of a uniform, -1 if the program has no such active uniform
+	GLint getUniformLocation(const std::string &name) const
+	{
+		auto it = uniform_locations.find(name);
+		return it == uniform_locations.end() ? -1 : it->second;
+	}
+	// Binds a uniform block of the program to a uniform buffer binding point
+	void bindUniformBlock(const std::string &name, GLuint binding) const
+	{
+		GLuint index = glGetUniformBlockIndex(Program, name.c_str());
+		if (index == GL_INVALID_INDEX)
+		{
+			std::cout << "ERROR::SHADER::UNIFORM_BLOCK_NOT_FOUND " << name << std::endl;
+			return;
+		}
+		glUniformBlockBinding(Program, index, binding);
+	}
 	// utility uniform functions
     // ------------------------------------------------------------------------
     void setBool(const std::string &name, bool value) const
     {         
-        glUniform1i(glGetUniformLocation(Program, name.c_str()), (int)value); 
+        glUniform1i(getUniformLocation(name), (int)value); 
     }
     // ------------------------------------------------------------------------
     void setInt(const std::string &name, int value) const
     { 
-        glUniform1i(glGetUniformLocation(Program, name.c_str()), value); 
+        glUniform1i(getUniformLocation(name), value); 
     }
     // ------------------------------------------------------------------------
     void setFloat(const std::string &name, float value) const
     { 
-        glUniform1f(glGetUniformLocation(Program, name.c_str()), value); 
+        glUniform1f(getUniformLocation(name), value); 
     }
     // ------------------------------------------------------------------------
     void setVec2(const std::string &name, const glm::vec2 &value) const
     { 
-        glUniform2fv(glGetUniformLocation(Program, name.c_str()), 1, &value[0]); 
+        glUniform2fv(getUniformLocation(name), 1, &value[0]); 
     }
     void setVec2(const std::string &name, float x, float y) const
     { 
-        glUniform2f(glGetUniformLocation(Program, name.c_str()), x, y); 
+        glUniform2f(getUniformLocation(name), x, y); 
     }
     // ------------------------------------------------------------------------
     void setVec3(const std::string &name, const glm::vec3 &value) const
     { 
-        glUniform3fv(glGetUniformLocation(Program, name.c_str()), 1, &value[0]); 
+        glUniform3fv(getUniformLocation(name), 1, &value[0]); 
     }
     void setVec3(const std::string &name, float x, float y, float z) const
     { 
-        glUniform3f(glGetUniformLocation(Program, name.c_str()), x, y, z); 
+        glUniform3f(getUniformLocation(name), x, y, z); 
     }
     // ------------------------------------------------------------------------
     void setVec4(const std::string &name, const glm::vec4 &value) const
     { 
-        glUniform4fv(glGetUniformLocation(Program, name.c_str()), 1, &value[0]); 
+        glUniform4fv(getUniformLocation(name), 1, &value[0]); 
     }
     void setVec4(const std::string &name, float x, float y, float z, float w) const
     { 
-        glUniform4f(glGetUniformLocation(Program, name.c_str()), x, y, z, w); 
+        glUniform4f(getUniformLocation(name), x, y, z, w); 
     }
     // ------------------------------------------------------------------------
     void setMat2(const std::string &name, const glm::mat2 &mat) const
     {
-        glUniformMatrix2fv(glGetUniformLocation(Program, name.c_str()), 1, GL_FALSE, &mat[0][0]);
+        glUniformMatrix2fv(getUniformLocation(name), 1, GL_FALSE, &mat[0][0]);
     }
     // ------------------------------------------------------------------------
     void setMat3(const std::string &name, const glm::mat3 &mat) const
     {
-        glUniformMatrix3fv(glGetUniformLocation(Program, name.c_str()), 1, GL_FALSE, &mat[0][0]);
+        glUniformMatrix3fv(getUniformLocation(name), 1, GL_FALSE, &mat[0][0]);
     }
     // ------------------------------------------------------------------------
     void setMat4(const std::string &name, const glm::mat4 &mat) const
     {
-        glUniformMatrix4fv(glGetUniformLocation(Program, name.c_str()), 1, GL_FALSE, &mat[0][0]);
+        glUniformMatrix4fv(getUniformLocation(name), 1, GL_FALSE, &mat[0][0]);
+    }
+
+private:
+    std::unordered_map<std::string, GLint> uniform_locations;
+
+    // Uniforms in a named block have no location and are left out
+    void cacheUniformLocations()
+    {
+        GLint count, max_length;
+        glGetProgramiv(Program, GL_ACTIVE_UNIFORMS, &count);
+        glGetProgramiv(Program, GL_ACTIVE_UNIFORM_MAX_LENGTH, &max_length);
+        std::string name(max_length, '\0');
+        for (GLint ix = 0; ix != count; ++ix)
+        {
+            GLsizei length;
+            GLint size;
+            GLenum type;
+            glGetActiveUniform(Program, ix, max_length, &length, &size, &type, &name[0]);
+            GLint location = glGetUniformLocation(Program, name.c_str());
+            if (location == -1) continue;
+            std::string key = name.substr(0, length);
+            // arrays are reported as "name[0]", make them reachable as "name" too
+            if (key.size() > 3 && key.compare(key.size() - 3, 3, "[0]") == 0)
+                uniform_locations[key.substr(0, key.size() - 3)] = location;
+            uniform_locations[key] = location;
+        }
     }
 };
+
+/*
+ * A uniform buffer object bound to a fixed binding point.
+ * The layout of T must follow std140 rules of the matching uniform block.
+ */
+template <typename T>
+class UniformBuffer
+{
+public:
+    UniformBuffer(GLuint binding): binding(binding)
+    {
+        glGenBuffers(1, &UBO);
+        glBindBuffer(GL_UNIFORM_BUFFER, UBO);
+        glBufferData(GL_UNIFORM_BUFFER, sizeof(T), NULL, GL_DYNAMIC_DRAW);
+        glBindBufferBase(GL_UNIFORM_BUFFER, binding, UBO);
+        glBindBuffer(GL_UNIFORM_BUFFER, 0);
+    }
+    UniformBuffer(const UniformBuffer&) = delete;
+    UniformBuffer& operator=(const UniformBuffer&) = delete;
+
+    GLuint getBinding() const { return binding; }
+
+    // Uploads the whole block at once
+    void update(const T &data)
+    {
+        glBindBuffer(GL_UNIFORM_BUFFER, UBO);
+        glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(T), &data);
+        glBindBuffer(GL_UNIFORM_BUFFER, 0);
+    }
+
+    // Must be called before the GL context is destroyed
+    void release()
+    {
+        glDeleteBuffers(1, &UBO);
+        UBO = 0;
+    }
+
+private:
+    GLuint UBO;
+    GLuint binding;
+};
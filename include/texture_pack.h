@@ -0,0 +1,241 @@
+#ifndef TEXTURE_PACK_H_
+#define TEXTURE_PACK_H_
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <sys/stat.h>
+
+#include "stb_image.h"
+
+#include "mapped_file.h"
+
+/*
+ * Face textures baked into one file, ready to upload as the layers of a
+ * texture array: RGBA8, square, a power of two in size, with every mipmap
+ * level already computed.
+ *
+ * The file holds a header followed by the levels from the largest down
+ * to 1x1, each level holding every layer in turn. Loading memory-maps the
+ * file, so startup neither decodes images nor generates mipmaps. The header
+ * records the size & modification time of every source image, so a pack
+ * older than its images is baked again.
+ */
+class TexturePack {
+public:
+    static const std::uint32_t VERSION = 2;
+    static const int MAX_LEVELS = 16;
+    static const int MAX_LAYERS = 16;
+
+    int getSize() const { return size; }
+    int getLayers() const { return layers; }
+    int getLevels() const { return levels; }
+    bool ready() const { return levels != 0; }
+
+    // width & height of a mipmap level
+    int levelSize(int level) const { return size >> level; }
+
+    // RGBA8 pixels of every layer at a mipmap level
+    const std::uint8_t* levelData(int level) const { return data + offset(level); }
+
+    /*
+     * Decode images and bake them: each is resampled to size x size with
+     * a box filter, then halved down to 1x1.
+     *
+     * @param n: # images, one layer each, at most MAX_LAYERS
+     * @param size: edge length of the largest level, a power of two
+     * @return false if an image can not be decoded
+     */
+    bool bake(int n, const std::string* paths, int size_ = 256){
+        close();
+        if(n > MAX_LAYERS) return false;
+        size = size_;
+        layers = n;
+        levels = 1;
+        while((size >> (levels - 1)) > 1 && levels != MAX_LEVELS) ++levels;
+        owned.assign(offset(levels), 0);
+
+        for(int ix = 0; ix != n; ++ix){
+            int width, height, nrchannels;
+            unsigned char *pixels = stbi_load(paths[ix].c_str(), &width, &height, &nrchannels, 4);
+            if(!pixels){
+                std::cerr << "Failed to load texture image " << paths[ix] << std::endl;
+                close();
+                return false;
+            }
+            resample(pixels, width, height, owned.data() + ix * layerBytes(0));
+            stbi_image_free(pixels);
+            stamp(paths[ix], sources[ix]);
+        }
+        for(int level = 1; level != levels; ++level){
+            for(int ix = 0; ix != n; ++ix)
+                halve(owned.data() + offset(level - 1) + ix * layerBytes(level - 1), levelSize(level - 1),
+                      owned.data() + offset(level) + ix * layerBytes(level));
+        }
+        data = owned.data();
+        return true;
+    }
+
+    bool save(const std::string& path) const {
+        if(!ready()) return false;
+        FILE* file = std::fopen(path.c_str(), "wb");
+        if(!file) return false;
+        Header header = makeHeader();
+        std::size_t bytes = offset(levels);
+        bool ok = std::fwrite(&header, sizeof(header), 1, file) == 1 &&
+                  std::fwrite(data, 1, bytes, file) == bytes;
+        return std::fclose(file) == 0 && ok;
+    }
+
+    /*
+     * Memory-map a pack saved by bake & save.
+     *
+     * @return false if the file is missing or of another version
+     */
+    bool load(const std::string& path){
+        close();
+        if(!mapped.open(path) || mapped.size() < sizeof(Header)) return false;
+
+        Header header;
+        std::memcpy(&header, mapped.data(), sizeof(header));
+        size = header.size;
+        layers = header.layers;
+        levels = header.levels;
+        bool ok = std::memcmp(header.magic, "CUBETEX", 8) == 0 && header.version == VERSION &&
+                  levels > 0 && levels <= MAX_LEVELS && (size >> (levels - 1)) >= 1 &&
+                  layers <= MAX_LAYERS && mapped.size() == sizeof(Header) + offset(levels);
+        if(!ok){
+            close();
+            return false;
+        }
+        std::copy(header.sources, header.sources + layers, sources);
+        data = mapped.data() + sizeof(Header);
+        return true;
+    }
+
+    /*
+     * Whether the pack was baked from these images as they are now.
+     * Images that can not be found are not held against the pack.
+     */
+    bool current(int n, const std::string* paths) const {
+        if(layers != n) return false;
+        for(int ix = 0; ix != n; ++ix){
+            Source now;
+            if(stamp(paths[ix], now) && (now.size != sources[ix].size || now.mtime != sources[ix].mtime))
+                return false;
+        }
+        return true;
+    }
+
+    /*
+     * Load the pack at path, or bake it from the images and save it there.
+     * A pack made from other versions of the images is baked again.
+     */
+    bool loadOrBake(const std::string& path, int n, const std::string* paths){
+        if(load(path) && current(n, paths)) return true;
+        if(!bake(n, paths)) return false;
+        if(!save(path)) std::cerr << "Failed to save baked textures to " << path << std::endl;
+        return true;
+    }
+
+    void close(){
+        mapped.close();
+        owned.clear();
+        owned.shrink_to_fit();
+        data = nullptr;
+        size = layers = levels = 0;
+    }
+
+private:
+    // size & modification time of the image a layer was baked from
+    struct Source {
+        std::uint64_t size;
+        std::int64_t mtime;
+    };
+
+    struct Header {
+        char magic[8];
+        std::uint32_t version;
+        std::uint32_t size;
+        std::uint32_t layers;
+        std::uint32_t levels;
+        Source sources[MAX_LAYERS];
+    };
+
+    int size = 0, layers = 0, levels = 0;
+    Source sources[MAX_LAYERS] = {};
+    const std::uint8_t* data = nullptr;
+    std::vector<std::uint8_t> owned;
+    MappedFile mapped;
+
+    Header makeHeader() const {
+        Header header;
+        std::memcpy(header.magic, "CUBETEX", 8);
+        header.version = VERSION;
+        header.size = size;
+        header.layers = layers;
+        header.levels = levels;
+        std::fill(header.sources, header.sources + MAX_LAYERS, Source());
+        std::copy(sources, sources + layers, header.sources);
+        return header;
+    }
+
+    static bool stamp(const std::string& path, Source& source){
+        struct stat info;
+        if(stat(path.c_str(), &info) != 0){
+            source = Source();
+            return false;
+        }
+        source.size = info.st_size;
+        source.mtime = info.st_mtime;
+        return true;
+    }
+
+    std::size_t layerBytes(int level) const {
+        return std::size_t(4) * levelSize(level) * levelSize(level);
+    }
+
+    std::size_t offset(int level) const {
+        std::size_t result = 0;
+        for(int l = 0; l != level; ++l) result += layers * layerBytes(l);
+        return result;
+    }
+
+    // box filter: every texel averages the source pixels it covers
+    void resample(const unsigned char* src, int width, int height, std::uint8_t* dst) const {
+        for(int y = 0; y != size; ++y){
+            int y0 = y * height / size, y1 = std::max(y0 + 1, (y + 1) * height / size);
+            for(int x = 0; x != size; ++x){
+                int x0 = x * width / size, x1 = std::max(x0 + 1, (x + 1) * width / size);
+                for(int c = 0; c != 4; ++c){
+                    unsigned sum = 0;
+                    for(int sy = y0; sy != y1; ++sy)
+                        for(int sx = x0; sx != x1; ++sx) sum += src[(sy * width + sx) * 4 + c];
+                    unsigned count = (y1 - y0) * (x1 - x0);
+                    dst[(y * size + x) * 4 + c] = static_cast<std::uint8_t>((sum + count / 2) / count);
+                }
+            }
+        }
+    }
+
+    static void halve(const std::uint8_t* src, int src_size, std::uint8_t* dst){
+        int dst_size = src_size / 2;
+        for(int y = 0; y != dst_size; ++y){
+            for(int x = 0; x != dst_size; ++x){
+                for(int c = 0; c != 4; ++c){
+                    unsigned sum = src[((2 * y) * src_size + 2 * x) * 4 + c] + src[((2 * y) * src_size + 2 * x + 1) * 4 + c] +
+                                   src[((2 * y + 1) * src_size + 2 * x) * 4 + c] + src[((2 * y + 1) * src_size + 2 * x + 1) * 4 + c];
+                    dst[(y * dst_size + x) * 4 + c] = static_cast<std::uint8_t>((sum + 2) / 4);
+                }
+            }
+        }
+    }
+};
+
+#endif
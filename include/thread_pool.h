@@ -0,0 +1,135 @@
+#ifndef THREAD_POOL_H_
+#define THREAD_POOL_H_
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/*
+ * Fixed size pool of worker threads with work stealing.
+ *
+ * Every worker owns a queue. Tasks submitted by a worker go to its own
+ * queue, others are dealt out round robin. Workers take their newest task
+ * first and steal the oldest task of another queue when theirs runs dry,
+ * so large subtrees split early are the ones that move between threads.
+ */
+class ThreadPool {
+public:
+    /*
+     * @param num_threads: number of workers, 0 for one per hardware thread
+     */
+    explicit ThreadPool(int num_threads = 0){
+        if(num_threads <= 0) num_threads = std::max(1u, std::thread::hardware_concurrency());
+        for(int ix = 0; ix != num_threads; ++ix) queues.emplace_back(new Queue);
+        for(int ix = 0; ix != num_threads; ++ix) threads.emplace_back(&ThreadPool::run, this, ix);
+    }
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    ~ThreadPool(){
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        wake.notify_all();
+        for(std::thread& t : threads) t.join();
+    }
+
+    int size() const { return static_cast<int>(threads.size()); }
+
+    void submit(std::function<void()> task){
+        int self = current_pool == this ? current_worker : -1;
+        int ix = self >= 0 ? self : static_cast<int>(next_queue++ % queues.size());
+        pending.fetch_add(1);
+        {
+            std::lock_guard<std::mutex> lock(queues[ix]->mutex);
+            queues[ix]->tasks.push_back(std::move(task));
+        }
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            ++queued;
+        }
+        wake.notify_one();
+    }
+
+    /*
+     * Block until every submitted task, including tasks they submit, is done.
+     * Must not be called from a worker.
+     */
+    void wait(){
+        std::unique_lock<std::mutex> lock(mutex);
+        idle.wait(lock, [this]{ return pending.load() == 0; });
+    }
+
+private:
+    struct Queue {
+        std::mutex mutex;
+        std::deque<std::function<void()>> tasks;
+    };
+
+    std::vector<std::unique_ptr<Queue>> queues;
+    std::vector<std::thread> threads;
+    std::mutex mutex;
+    std::condition_variable wake, idle;
+    std::atomic<int> pending{0};
+    std::atomic<unsigned> next_queue{0};
+    int queued = 0;
+    bool stopping = false;
+
+    // the pool & queue of the worker running on this thread
+    static inline thread_local ThreadPool* current_pool = nullptr;
+    static inline thread_local int current_worker = -1;
+
+    bool pop(int self, std::function<void()>& task){
+        {
+            Queue& own = *queues[self];
+            std::lock_guard<std::mutex> lock(own.mutex);
+            if(!own.tasks.empty()){
+                task = std::move(own.tasks.back());
+                own.tasks.pop_back();
+                return true;
+            }
+        }
+        for(std::size_t k = 1; k != queues.size(); ++k){
+            Queue& other = *queues[(self + k) % queues.size()];
+            std::lock_guard<std::mutex> lock(other.mutex);
+            if(!other.tasks.empty()){
+                task = std::move(other.tasks.front());
+                other.tasks.pop_front();
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void run(int self){
+        current_pool = this;
+        current_worker = self;
+        std::function<void()> task;
+        while(true){
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                wake.wait(lock, [this]{ return stopping || queued > 0; });
+                if(queued == 0) return;
+                // claim a task before looking for it, so sleeping workers are not woken in vain
+                --queued;
+            }
+            while(!pop(self, task)) std::this_thread::yield();
+            task();
+            task = nullptr;
+            if(pending.fetch_sub(1) == 1){
+                std::lock_guard<std::mutex> lock(mutex);
+                idle.notify_all();
+            }
+        }
+    }
+};
+
+#endif
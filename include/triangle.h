@@ -6,7 +6,8 @@
 #include <glm/gtc/type_ptr.hpp>
 
 struct HitRecord{
-    int ix;
+    int face;        // Face the hit point lies on
+    glm::ivec3 grid; // (col, layer, row) of the cube being hit
     float t;
     glm::vec3 p;
 };
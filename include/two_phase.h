@@ -0,0 +1,735 @@
+#ifndef TWO_PHASE_H_
+#define TWO_PHASE_H_
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "cubie_cube.h"
+#include "mapped_file.h"
+#include "thread_pool.h"
+
+/*
+ * Coordinates of a CubieCube used by the two-phase solver.
+ * Every coordinate of the solved cube is 0.
+ *
+ * Phase 1 brings the cube into the subgroup <U, D, R2, L2, F2, B2>:
+ *   twist  orientation of 7 corners (3^7)
+ *   flip   orientation of 11 edges (2^11)
+ *   slice  positions of the 4 UD-slice edges FR FL BL BR, ignoring order (12 choose 4)
+ * Phase 2 solves the cube inside that subgroup:
+ *   cperm  permutation of the 8 corners (8!)
+ *   eperm  permutation of the 8 U/D edges (8!)
+ *   sperm  permutation of the 4 UD-slice edges (4!)
+ */
+struct CubeCoordinates {
+    static const int N_TWIST = 2187;
+    static const int N_FLIP = 2048;
+    static const int N_SLICE = 495;
+    static const int N_CPERM = 40320;
+    static const int N_EPERM = 40320;
+    static const int N_SPERM = 24;
+
+    static int binomial(int n, int k){
+        if(k < 0 || k > n) return 0;
+        int result = 1;
+        for(int ix = 0; ix != k; ++ix) result = result * (n - ix) / (ix + 1);
+        return result;
+    }
+
+    static int getTwist(const CubieCube& c){
+        int twist = 0;
+        for(int ix = 0; ix != 7; ++ix) twist = 3 * twist + c.cornerOrientation(ix);
+        return twist;
+    }
+
+    static void setTwist(CubieCube& c, int twist){
+        int sum = 0;
+        for(int ix = 6; ix >= 0; --ix){
+            c.setCorner(ix, c.cornerPermutation(ix), twist % 3);
+            sum += twist % 3;
+            twist /= 3;
+        }
+        c.setCorner(7, c.cornerPermutation(7), (3 - sum % 3) % 3);
+    }
+
+    static int getFlip(const CubieCube& c){
+        int flip = 0;
+        for(int ix = 0; ix != 11; ++ix) flip = 2 * flip + c.edgeOrientation(ix);
+        return flip;
+    }
+
+    static void setFlip(CubieCube& c, int flip){
+        int sum = 0;
+        for(int ix = 10; ix >= 0; --ix){
+            c.setEdge(ix, c.edgePermutation(ix), flip % 2);
+            sum += flip % 2;
+            flip /= 2;
+        }
+        c.setEdge(11, c.edgePermutation(11), sum % 2);
+    }
+
+    static int getSlice(const CubieCube& c){
+        int slice = 0, found = 0;
+        for(int ix = 11; ix >= 0; --ix){
+            if(c.edgePermutation(ix) >= 8){
+                slice += binomial(11 - ix, found + 1);
+                ++found;
+            }
+        }
+        return slice;
+    }
+
+    static void setSlice(CubieCube& c, int slice){
+        int left = 4, slice_edge = 8, other_edge = 0;
+        for(int ix = 0; ix != 12; ++ix){
+            if(left > 0 && slice - binomial(11 - ix, left) >= 0){
+                slice -= binomial(11 - ix, left);
+                c.setEdge(ix, slice_edge++, c.edgeOrientation(ix));
+                --left;
+            }
+            else{
+                c.setEdge(ix, other_edge++, c.edgeOrientation(ix));
+            }
+        }
+    }
+
+    static int getCornerPerm(const CubieCube& c){
+        int perm[8];
+        for(int ix = 0; ix != 8; ++ix) perm[ix] = c.cornerPermutation(ix);
+        return lehmer(perm, 8);
+    }
+
+    static void setCornerPerm(CubieCube& c, int index){
+        int perm[8];
+        unlehmer(index, perm, 8);
+        for(int ix = 0; ix != 8; ++ix) c.setCorner(ix, perm[ix], c.cornerOrientation(ix));
+    }
+
+    static int getEdgePerm(const CubieCube& c){
+        int perm[8];
+        for(int ix = 0; ix != 8; ++ix) perm[ix] = c.edgePermutation(ix);
+        return lehmer(perm, 8);
+    }
+
+    static void setEdgePerm(CubieCube& c, int index){
+        int perm[8];
+        unlehmer(index, perm, 8);
+        for(int ix = 0; ix != 8; ++ix) c.setEdge(ix, perm[ix], c.edgeOrientation(ix));
+    }
+
+    static int getSlicePerm(const CubieCube& c){
+        int perm[4];
+        for(int ix = 0; ix != 4; ++ix) perm[ix] = c.edgePermutation(8 + ix) - 8;
+        return lehmer(perm, 4);
+    }
+
+    static void setSlicePerm(CubieCube& c, int index){
+        int perm[4];
+        unlehmer(index, perm, 4);
+        for(int ix = 0; ix != 4; ++ix) c.setEdge(8 + ix, 8 + perm[ix], c.edgeOrientation(8 + ix));
+    }
+
+    /*
+     * A CubieCube is solvable when cubies are a permutation, twists and
+     * flips add up and corner & edge permutations have the same parity.
+     */
+    static bool solvable(const CubieCube& c){
+        int seen = 0, sum = 0;
+        int corners[8], edges[12];
+        for(int ix = 0; ix != 8; ++ix){
+            corners[ix] = c.cornerPermutation(ix);
+            seen |= 1 << corners[ix];
+            sum += c.cornerOrientation(ix);
+        }
+        if(seen != 0xff || sum % 3 != 0) return false;
+        seen = sum = 0;
+        for(int ix = 0; ix != 12; ++ix){
+            edges[ix] = c.edgePermutation(ix);
+            seen |= 1 << edges[ix];
+            sum += c.edgeOrientation(ix);
+        }
+        if(seen != 0xfff || sum % 2 != 0) return false;
+        return parity(corners, 8) == parity(edges, 12);
+    }
+
+private:
+    static int lehmer(const int* perm, int n){
+        int index = 0;
+        for(int ix = 0; ix != n; ++ix){
+            int smaller = 0;
+            for(int jx = ix + 1; jx != n; ++jx)
+                if(perm[jx] < perm[ix]) ++smaller;
+            index = index * (n - ix) + smaller;
+        }
+        return index;
+    }
+
+    static void unlehmer(int index, int* perm, int n){
+        int digits[12];
+        for(int ix = n - 1; ix >= 0; --ix){
+            digits[ix] = index % (n - ix);
+            index /= n - ix;
+        }
+        bool used[12] = {false};
+        for(int ix = 0; ix != n; ++ix){
+            int value = 0;
+            for(int k = digits[ix]; used[value] || k > 0; ++value)
+                if(!used[value]) --k;
+            perm[ix] = value;
+            used[value] = true;
+        }
+    }
+
+    static int parity(const int* perm, int n){
+        int inversions = 0;
+        for(int ix = 0; ix != n; ++ix)
+            for(int jx = ix + 1; jx != n; ++jx)
+                if(perm[jx] < perm[ix]) ++inversions;
+        return inversions % 2;
+    }
+};
+
+/*
+ * Move & pruning tables of the two-phase solver, about 5 MB in total.
+ * Pruning distances are packed two to a byte.
+ *
+ * Tables are kept in a versioned file: a header with the move set the
+ * tables were built for and a directory holding the offset, size, checksum
+ * and completion of every table, followed by the tables themselves.
+ * Loading memory-maps the file, so startup does not grow with the tables
+ * and processes using them share the pages. The generator runs on a
+ * thread pool and writes every table as soon as it is complete; a run
+ * that was interrupted picks up at the first incomplete table.
+ */
+class TwoPhaseTables {
+public:
+    typedef CubeCoordinates C;
+    static const int NUM_MOVES = CubieCube::NUM_MOVES;
+    static const int NUM_TABLES = 10;
+    static const std::uint32_t VERSION = 2;
+
+    const std::uint16_t* twist_move = nullptr;   // [N_TWIST][NUM_MOVES]
+    const std::uint16_t* flip_move = nullptr;    // [N_FLIP][NUM_MOVES]
+    const std::uint16_t* slice_move = nullptr;   // [N_SLICE][NUM_MOVES]
+    const std::uint16_t* cperm_move = nullptr;   // [N_CPERM][NUM_MOVES], phase 2 moves only
+    const std::uint16_t* eperm_move = nullptr;   // [N_EPERM][NUM_MOVES], phase 2 moves only
+    const std::uint16_t* sperm_move = nullptr;   // [N_SPERM][NUM_MOVES], phase 2 moves only
+    const std::uint8_t* slice_twist_prune = nullptr;  // [N_SLICE][N_TWIST], see distance()
+    const std::uint8_t* slice_flip_prune = nullptr;   // [N_SLICE][N_FLIP]
+    const std::uint8_t* sperm_cperm_prune = nullptr;  // [N_SPERM][N_CPERM]
+    const std::uint8_t* sperm_eperm_prune = nullptr;  // [N_SPERM][N_EPERM]
+
+    bool ready() const { return twist_move != nullptr; }
+
+    static bool isPhase2Move(int m){
+        int face = m / 3;
+        // U & D turns of any amount, half turns of the other faces
+        return face == 0 || face == 3 || m % 3 == 1;
+    }
+
+    /*
+     * Distance stored at index ix of a pruning table.
+     */
+    static int distance(const std::uint8_t* table, std::size_t ix){
+        return table[ix >> 1] >> ((ix & 1) << 2) & 0xf;
+    }
+
+    /*
+     * Build every table in memory.
+     *
+     * @param num_threads: generator threads, 0 for one per hardware thread
+     */
+    void generate(int num_threads = 0){
+        build(nullptr, num_threads);
+    }
+
+    /*
+     * Build every table and write them to path. Complete tables of an
+     * earlier run on the same file are read back instead of built again.
+     *
+     * @return false if the file can not be written, the tables are built anyway
+     */
+    bool generate(const std::string& path, int num_threads = 0){
+        FILE* file = std::fopen(path.c_str(), "r+b");
+        // a file of another version or layout is started over, so it never
+        // keeps a size load rejects
+        if(file && !resumable(file)){
+            std::fclose(file);
+            file = nullptr;
+        }
+        if(!file) file = std::fopen(path.c_str(), "w+b");
+        if(!file){
+            build(nullptr, num_threads);
+            return false;
+        }
+        bool ok = build(file, num_threads);
+        return std::fclose(file) == 0 && ok;
+    }
+
+    /*
+     * Save tables generated in memory.
+     */
+    bool save(const std::string& path) const {
+        if(owned.empty()) return false;
+        FILE* file = std::fopen(path.c_str(), "wb");
+        if(!file) return false;
+        Header header = makeHeader();
+        for(int ix = 0; ix != NUM_TABLES; ++ix){
+            header.tables[ix].checksum = checksum(owned.data() + offset(ix), tableSize(ix));
+            header.tables[ix].complete = 1;
+        }
+        bool ok = writeHeader(file, header) &&
+                  std::fwrite(owned.data(), 1, owned.size(), file) == owned.size();
+        return std::fclose(file) == 0 && ok;
+    }
+
+    /*
+     * Memory-map tables saved by a previous run.
+     *
+     * @param verify: also check the checksum of every table, which reads the whole file
+     * @return false if the file is missing, incomplete or of another version or move set
+     */
+    bool load(const std::string& path, bool verify = false){
+        owned.clear();
+        owned.shrink_to_fit();
+        twist_move = nullptr;
+        if(!mapped.open(path)) return false;
+
+        Header header;
+        bool ok = mapped.size() == HEADER_SIZE + totalSize();
+        if(ok){
+            std::memcpy(&header, mapped.data(), sizeof(header));
+            ok = validHeader(header);
+        }
+        for(int ix = 0; ix != NUM_TABLES && ok; ++ix){
+            ok = header.tables[ix].complete == 1 &&
+                 (!verify || checksum(mapped.data() + HEADER_SIZE + offset(ix), tableSize(ix)) == header.tables[ix].checksum);
+        }
+        if(!ok){
+            mapped.close();
+            return false;
+        }
+        bind(mapped.data() + HEADER_SIZE);
+        return true;
+    }
+
+    /*
+     * Load tables from path, or generate them there.
+     *
+     * @return false if the tables had to be generated and could not be saved
+     */
+    bool loadOrGenerate(const std::string& path){
+        if(load(path)) return true;
+        return generate(path);
+    }
+
+private:
+    struct TableEntry {
+        std::uint64_t offset;    // from the start of the file
+        std::uint64_t size;
+        std::uint64_t checksum;  // FNV-1a of the table
+        std::uint32_t complete;
+        std::uint32_t reserved;
+    };
+
+    struct Header {
+        char magic[8];
+        std::uint32_t version;
+        std::uint32_t num_tables;
+        char move_set[192];      // every move, then the phase 2 moves
+        TableEntry tables[NUM_TABLES];
+        std::uint64_t checksum;  // FNV-1a of the header up to here
+    };
+
+    // tables start on a page boundary
+    static const std::size_t HEADER_SIZE = 4096;
+
+    std::vector<std::uint8_t> owned;
+    MappedFile mapped;
+
+    static std::uint64_t checksum(const std::uint8_t* data, std::size_t size){
+        std::uint64_t hash = 14695981039346656037ull;
+        for(std::size_t ix = 0; ix != size; ++ix){
+            hash ^= data[ix];
+            hash *= 1099511628211ull;
+        }
+        return hash;
+    }
+
+    static std::uint64_t headerChecksum(const Header& header){
+        return checksum(reinterpret_cast<const std::uint8_t*>(&header), offsetof(Header, checksum));
+    }
+
+    static Header makeHeader(){
+        Header header;
+        std::memset(&header, 0, sizeof(header));
+        std::memcpy(header.magic, "2PHASE\0", 8);
+        header.version = VERSION;
+        header.num_tables = NUM_TABLES;
+
+        std::string moves;
+        for(int m = 0; m != NUM_MOVES; ++m) moves += CubieCube::moveName(m) + " ";
+        moves += "/";
+        for(int m = 0; m != NUM_MOVES; ++m)
+            if(isPhase2Move(m)) moves += " " + CubieCube::moveName(m);
+        std::memcpy(header.move_set, moves.c_str(), std::min(moves.size(), sizeof(header.move_set) - 1));
+
+        for(int ix = 0; ix != NUM_TABLES; ++ix){
+            header.tables[ix].offset = HEADER_SIZE + offset(ix);
+            header.tables[ix].size = tableSize(ix);
+        }
+        return header;
+    }
+
+    // same version, move set & layout as this build, completion and checksums may differ
+    static bool validHeader(const Header& header){
+        Header expected = makeHeader();
+        if(std::memcmp(&header, &expected, offsetof(Header, tables)) != 0 ||
+           header.checksum != headerChecksum(header))
+            return false;
+        for(int ix = 0; ix != NUM_TABLES; ++ix){
+            if(header.tables[ix].offset != expected.tables[ix].offset ||
+               header.tables[ix].size != expected.tables[ix].size)
+                return false;
+        }
+        return true;
+    }
+
+    static bool writeHeader(FILE* file, Header& header){
+        header.checksum = headerChecksum(header);
+        std::vector<std::uint8_t> block(HEADER_SIZE, 0);
+        std::memcpy(block.data(), &header, sizeof(header));
+        return std::fseek(file, 0, SEEK_SET) == 0 &&
+               std::fwrite(block.data(), 1, block.size(), file) == block.size() &&
+               std::fflush(file) == 0;
+    }
+
+    // size in bytes of each table, in file order
+    static std::size_t tableSize(int ix){
+        static const std::size_t sizes[NUM_TABLES] = {
+            2 * NUM_MOVES * C::N_TWIST, 2 * NUM_MOVES * C::N_FLIP, 2 * NUM_MOVES * C::N_SLICE,
+            2 * NUM_MOVES * C::N_CPERM, 2 * NUM_MOVES * C::N_EPERM, 2 * NUM_MOVES * C::N_SPERM,
+            (std::size_t(C::N_SLICE) * C::N_TWIST + 1) / 2, (std::size_t(C::N_SLICE) * C::N_FLIP + 1) / 2,
+            (std::size_t(C::N_SPERM) * C::N_CPERM + 1) / 2, (std::size_t(C::N_SPERM) * C::N_EPERM + 1) / 2
+        };
+        return sizes[ix];
+    }
+
+    // tables are 64-byte aligned after the header
+    static std::size_t offset(int ix){
+        std::size_t result = 0;
+        for(int jx = 0; jx != ix; ++jx) result += (tableSize(jx) + 63) / 64 * 64;
+        return result;
+    }
+
+    static std::size_t totalSize(){ return offset(NUM_TABLES); }
+
+    void bind(const std::uint8_t* base){
+        twist_move = reinterpret_cast<const std::uint16_t*>(base + offset(0));
+        flip_move = reinterpret_cast<const std::uint16_t*>(base + offset(1));
+        slice_move = reinterpret_cast<const std::uint16_t*>(base + offset(2));
+        cperm_move = reinterpret_cast<const std::uint16_t*>(base + offset(3));
+        eperm_move = reinterpret_cast<const std::uint16_t*>(base + offset(4));
+        sperm_move = reinterpret_cast<const std::uint16_t*>(base + offset(5));
+        slice_twist_prune = base + offset(6);
+        slice_flip_prune = base + offset(7);
+        sperm_cperm_prune = base + offset(8);
+        sperm_eperm_prune = base + offset(9);
+    }
+
+    // header valid for this version & move set, and no longer than the complete file
+    bool resumable(FILE* file) const {
+        Header header;
+        return std::fseek(file, 0, SEEK_END) == 0 && std::ftell(file) >= 0 &&
+               static_cast<std::size_t>(std::ftell(file)) <= HEADER_SIZE + totalSize() &&
+               std::fseek(file, 0, SEEK_SET) == 0 &&
+               std::fread(&header, sizeof(header), 1, file) == 1 && validHeader(header);
+    }
+
+    /*
+     * Build the tables in order, prune tables need the move tables before
+     * them. With a file, complete tables are read from it and the others
+     * written to it one by one.
+     */
+    bool build(FILE* file, int num_threads){
+        mapped.close();
+        owned.assign(totalSize(), 0);
+        std::uint8_t* base = owned.data();
+        bind(base);
+
+        Header header = makeHeader();
+        bool ok = true;
+        if(file){
+            Header old;
+            bool resume = std::fseek(file, 0, SEEK_SET) == 0 &&
+                          std::fread(&old, sizeof(old), 1, file) == 1 && validHeader(old);
+            if(resume) header = old;
+            else ok = writeHeader(file, header);
+        }
+
+        ThreadPool pool(num_threads);
+        for(int ix = 0; ix != NUM_TABLES; ++ix){
+            std::uint8_t* table = base + offset(ix);
+            TableEntry& entry = header.tables[ix];
+            if(file && entry.complete == 1 &&
+               std::fseek(file, static_cast<long>(entry.offset), SEEK_SET) == 0 &&
+               std::fread(table, 1, entry.size, file) == entry.size &&
+               checksum(table, entry.size) == entry.checksum)
+                continue;
+
+            buildTable(ix, table, pool);
+            if(!file || !ok) continue;
+            entry.checksum = checksum(table, entry.size);
+            entry.complete = 1;
+            // padding included, so the file has its full size once the last table is in
+            std::size_t padded = offset(ix + 1) - offset(ix);
+            ok = std::fseek(file, static_cast<long>(entry.offset), SEEK_SET) == 0 &&
+                 std::fwrite(table, 1, padded, file) == padded &&
+                 std::fflush(file) == 0 && writeHeader(file, header);
+        }
+        return ok;
+    }
+
+    void buildTable(int ix, std::uint8_t* table, ThreadPool& pool){
+        std::uint16_t* move_table = reinterpret_cast<std::uint16_t*>(table);
+        switch(ix){
+            case 0: fillMoveTable(move_table, C::N_TWIST, false, C::setTwist, C::getTwist, pool); break;
+            case 1: fillMoveTable(move_table, C::N_FLIP, false, C::setFlip, C::getFlip, pool); break;
+            case 2: fillMoveTable(move_table, C::N_SLICE, false, C::setSlice, C::getSlice, pool); break;
+            case 3: fillMoveTable(move_table, C::N_CPERM, true, C::setCornerPerm, C::getCornerPerm, pool); break;
+            case 4: fillMoveTable(move_table, C::N_EPERM, true, C::setEdgePerm, C::getEdgePerm, pool); break;
+            case 5: fillMoveTable(move_table, C::N_SPERM, true, C::setSlicePerm, C::getSlicePerm, pool); break;
+            case 6: fillPruneTable(table, slice_move, C::N_SLICE, twist_move, C::N_TWIST, false, pool); break;
+            case 7: fillPruneTable(table, slice_move, C::N_SLICE, flip_move, C::N_FLIP, false, pool); break;
+            case 8: fillPruneTable(table, sperm_move, C::N_SPERM, cperm_move, C::N_CPERM, true, pool); break;
+            case 9: fillPruneTable(table, sperm_move, C::N_SPERM, eperm_move, C::N_EPERM, true, pool); break;
+        }
+    }
+
+    static const int CHUNK = 1 << 14;
+
+    static void fillMoveTable(std::uint16_t* table, int n, bool phase2_only,
+                              void (*set)(CubieCube&, int), int (*get)(const CubieCube&), ThreadPool& pool){
+        for(int first = 0; first < n; first += CHUNK){
+            pool.submit([=]{
+                for(int ix = first; ix != std::min(n, first + CHUNK); ++ix){
+                    CubieCube cube;
+                    set(cube, ix);
+                    for(int m = 0; m != NUM_MOVES; ++m){
+                        if(phase2_only && !isPhase2Move(m)){
+                            table[ix * NUM_MOVES + m] = 0;
+                            continue;
+                        }
+                        CubieCube next = cube;
+                        next.move(m);
+                        table[ix * NUM_MOVES + m] = get(next);
+                    }
+                }
+            });
+        }
+        pool.wait();
+    }
+
+    /*
+     * Breadth-first search over pairs of coordinates (a, b), index a * nb + b.
+     * Every level scans the table in chunks on the pool; distances go into
+     * a byte per entry first and are packed once the search is done.
+     */
+    static void fillPruneTable(std::uint8_t* table, const std::uint16_t* a_move, int na,
+                               const std::uint16_t* b_move, int nb, bool phase2_only, ThreadPool& pool){
+        const std::size_t n = std::size_t(na) * nb;
+        std::vector<std::atomic<std::int8_t>> dist(n);
+        for(std::size_t ix = 0; ix != n; ++ix) dist[ix].store(-1, std::memory_order_relaxed);
+        dist[0] = 0;
+
+        for(int depth = 0; ; ++depth){
+            std::atomic<std::size_t> added{0};
+            for(std::size_t first = 0; first < n; first += CHUNK){
+                pool.submit([&, first]{
+                    std::size_t count = 0;
+                    for(std::size_t ix = first; ix != std::min(n, first + CHUNK); ++ix){
+                        if(dist[ix].load(std::memory_order_relaxed) != depth) continue;
+                        int a = ix / nb, b = ix % nb;
+                        for(int m = 0; m != NUM_MOVES; ++m){
+                            if(phase2_only && !isPhase2Move(m)) continue;
+                            std::size_t next = std::size_t(a_move[a * NUM_MOVES + m]) * nb + b_move[b * NUM_MOVES + m];
+                            std::int8_t unseen = -1;
+                            if(dist[next].compare_exchange_strong(unseen, static_cast<std::int8_t>(depth + 1),
+                                                                  std::memory_order_relaxed))
+                                ++count;
+                        }
+                    }
+                    added += count;
+                });
+            }
+            pool.wait();
+            if(added == 0) break;
+        }
+
+        std::memset(table, 0, (n + 1) / 2);
+        for(std::size_t ix = 0; ix != n; ++ix){
+            int d = dist[ix].load(std::memory_order_relaxed);
+            // unreachable entries get the largest distance
+            table[ix >> 1] |= (d < 0 || d > 0xf ? 0xf : d) << ((ix & 1) << 2);
+        }
+    }
+};
+
+/*
+ * Kociemba's two-phase algorithm. Phase 1 searches (IDA*) for move sequences
+ * reaching <U, D, R2, L2, F2, B2>, phase 2 solves within that subgroup, and
+ * the search keeps looking for shorter totals until target_length is met
+ * or the time budget runs out.
+ */
+class TwoPhaseSolver {
+public:
+    TwoPhaseSolver(const TwoPhaseTables& tables_): tables(tables_) {}
+
+    /*
+     * @param cube: cube to solve, must be solvable
+     * @param solution: face turns (CubieCube numbering) solving the cube
+     * @param target_length: stop as soon as a solution this short is found
+     * @param time_limit_ms: give up improving after this long
+     * @return false if the cube is not solvable or no solution was found
+     */
+    bool solve(const CubieCube& cube, std::vector<int>& solution,
+               int target_length = 21, double time_limit_ms = 100.0){
+        solution.clear();
+        if(!CubeCoordinates::solvable(cube)) return false;
+
+        start = cube;
+        target = target_length;
+        best.clear();
+        best_length = MAX_LENGTH + 1;
+        deadline = std::chrono::steady_clock::now() +
+                   std::chrono::microseconds(static_cast<long long>(time_limit_ms * 1000));
+        stop = false;
+
+        int twist = CubeCoordinates::getTwist(cube);
+        int flip = CubeCoordinates::getFlip(cube);
+        int slice = CubeCoordinates::getSlice(cube);
+        for(int depth = phase1Bound(twist, flip, slice); depth < best_length && !stop; ++depth)
+            phase1(twist, flip, slice, 0, depth, -1);
+
+        if(best_length > MAX_LENGTH) return false;
+        solution = best;
+        return true;
+    }
+
+    // skip turning the same face twice, and opposite faces in both orders
+    static bool redundant(int m, int last){
+        if(last < 0) return false;
+        int face = m / 3, last_face = last / 3;
+        return face == last_face || face == last_face - 3;
+    }
+
+private:
+    static const int MAX_LENGTH = 30;
+    static const int NUM_MOVES = CubieCube::NUM_MOVES;
+
+    const TwoPhaseTables& tables;
+    CubieCube start;
+    int target;
+    int path[MAX_LENGTH + 1];
+    std::vector<int> best;
+    int best_length;
+    std::chrono::steady_clock::time_point deadline;
+    bool stop;
+
+    int phase1Bound(int twist, int flip, int slice) const {
+        int a = TwoPhaseTables::distance(tables.slice_twist_prune, slice * CubeCoordinates::N_TWIST + twist);
+        int b = TwoPhaseTables::distance(tables.slice_flip_prune, slice * CubeCoordinates::N_FLIP + flip);
+        return a > b ? a : b;
+    }
+
+    int phase2Bound(int cperm, int eperm, int sperm) const {
+        int a = TwoPhaseTables::distance(tables.sperm_cperm_prune, sperm * CubeCoordinates::N_CPERM + cperm);
+        int b = TwoPhaseTables::distance(tables.sperm_eperm_prune, sperm * CubeCoordinates::N_EPERM + eperm);
+        return a > b ? a : b;
+    }
+
+    void phase1(int twist, int flip, int slice, int depth, int togo, int last){
+        if(stop) return;
+        if(togo == 0){
+            // a trailing phase 2 move means a shorter phase 1 solution was already tried
+            if(twist == 0 && flip == 0 && slice == 0 &&
+               (last < 0 || !TwoPhaseTables::isPhase2Move(last)))
+                startPhase2(depth);
+            return;
+        }
+        for(int m = 0; m != NUM_MOVES; ++m){
+            if(redundant(m, last)) continue;
+            int t = tables.twist_move[twist * NUM_MOVES + m];
+            int f = tables.flip_move[flip * NUM_MOVES + m];
+            int s = tables.slice_move[slice * NUM_MOVES + m];
+            if(phase1Bound(t, f, s) >= togo) continue;
+            path[depth] = m;
+            phase1(t, f, s, depth + 1, togo - 1, m);
+            if(stop) return;
+        }
+    }
+
+    void startPhase2(int depth1){
+        if(std::chrono::steady_clock::now() > deadline && best_length <= MAX_LENGTH){
+            stop = true;
+            return;
+        }
+        CubieCube cube = start;
+        for(int ix = 0; ix != depth1; ++ix) cube.move(path[ix]);
+        int cperm = CubeCoordinates::getCornerPerm(cube);
+        int eperm = CubeCoordinates::getEdgePerm(cube);
+        int sperm = CubeCoordinates::getSlicePerm(cube);
+
+        int last = depth1 > 0 ? path[depth1 - 1] : -1;
+        for(int depth2 = phase2Bound(cperm, eperm, sperm); depth1 + depth2 < best_length; ++depth2){
+            if(phase2(cperm, eperm, sperm, depth1, depth2, last)){
+                best.assign(path, path + depth1 + depth2);
+                best_length = depth1 + depth2;
+                if(best_length <= target) stop = true;
+                return;
+            }
+        }
+    }
+
+    bool phase2(int cperm, int eperm, int sperm, int depth, int togo, int last){
+        if(togo == 0) return cperm == 0 && eperm == 0 && sperm == 0;
+        for(int m = 0; m != NUM_MOVES; ++m){
+            if(!TwoPhaseTables::isPhase2Move(m) || redundant(m, last)) continue;
+            int c = tables.cperm_move[cperm * NUM_MOVES + m];
+            int e = tables.eperm_move[eperm * NUM_MOVES + m];
+            int s = tables.sperm_move[sperm * NUM_MOVES + m];
+            if(phase2Bound(c, e, s) >= togo) continue;
+            path[depth] = m;
+            if(phase2(c, e, s, depth + 1, togo - 1, m)) return true;
+        }
+        return false;
+    }
+};
+
+/*
+ * Solve a rank 3 state, e.g. the one shown by MagicCube.
+ *
+ * @param moves: solution as moves of the state, ready for MagicCube::rotate
+ * @return false if the state is not a solvable 3x3x3
+ */
+inline bool solveState(const TwoPhaseTables& tables, const CubeState& state, std::vector<Move>& moves){
+    CubieCube cube;
+    if(!CubieCube::fromState(state, cube)) return false;
+
+    std::vector<int> solution;
+    TwoPhaseSolver solver(tables);
+    if(!solver.solve(cube, solution)) return false;
+
+    moves.clear();
+    for(int m : solution) moves.push_back(CubieCube::toMove(m));
+    return true;
+}
+
+#endif
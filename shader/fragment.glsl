@@ -1,19 +1,44 @@
 #version 330 core
 
-in vec2 texCoords;
+in vec3 texCoords;
+flat in uint faceColor;
 in vec3 fragNorm;
 in vec3 fragPos;
 
 out vec4 resultColor;
 
-uniform sampler2D texSampler;
-uniform vec3 cameraPos;
-uniform vec3 lightPos;
-uniform vec3 light_ambient;
-uniform vec3 light_diffuse;
+uniform sampler2DArray texSampler;
+
+layout (std140) uniform FrameData {
+    mat4 view;
+    mat4 perspective;
+    vec3 cameraPos;
+    vec3 lightPos;
+    vec3 light_ambient;
+    vec3 light_diffuse;
+    bool proceduralStickers;
+};
+
+// colors of the face textures, in texture layer order
+const vec3 STICKER_COLORS[7] = vec3[7](
+    vec3(0.0f), vec3(0.0f, 0.69f, 0.314f), vec3(0.773f, 0.353f, 0.067f), vec3(0.741f, 0.184f, 0.012f),
+    vec3(0.0f, 0.439f, 0.753f), vec3(1.0f, 0.851f, 0.4f), vec3(1.0f)
+);
+const float STICKER_BORDER = 0.02f;   // black border around the sticker, in face widths
+const float STICKER_RADIUS = 0.08f;   // corner radius of the sticker
+
+// sticker drawn analytically: a rounded square inset in the black face,
+// its edge smoothed over one pixel at every zoom
+vec3 stickerColor(){
+    vec3 color = STICKER_COLORS[min(faceColor, 6u)];
+    vec2 q = abs(texCoords.xy - 0.5f) - (0.5f - STICKER_BORDER - STICKER_RADIUS);
+    float dist = length(max(q, 0.0f)) + min(max(q.x, q.y), 0.0f) - STICKER_RADIUS;
+    float pixel = length(fwidth(texCoords.xy));
+    return color * (1.0f - smoothstep(-0.5f * pixel, 0.5f * pixel, dist));
+}
 
 void main(){
-    vec3 fragColor = vec3(texture(texSampler, texCoords));
+    vec3 fragColor = proceduralStickers ? stickerColor() : vec3(texture(texSampler, texCoords));
 
     vec3 ambient = light_ambient * fragColor;
     // compute diffuse lighting
@@ -23,4 +48,4 @@ void main(){
 
     vec3  res = ambient + diffuse;
     resultColor = vec4(res, 1.0f);
-}
\ No newline at end of file
+}
@@ -3,19 +3,40 @@
 layout (location = 0) in vec3 inPos;
 layout (location = 1) in vec2 inTexCoords;
 layout (location = 2) in vec3 inNorm;
+// per-instance attributes
+layout (location = 3) in mat4 model;
+layout (location = 7) in uint faceTex;
+layout (location = 8) in uvec3 grid;     // col, layer, row
 
-out vec2 texCoords;
+out vec3 texCoords;
+flat out uint faceColor;
 out vec3 fragNorm;
 out vec3 fragPos;
 
-uniform mat4 model;
-uniform mat4 view;
-uniform mat4 perspective;
-uniform mat3 normModel;
+layout (std140) uniform FrameData {
+    mat4 view;
+    mat4 perspective;
+    vec3 cameraPos;
+    vec3 lightPos;
+    vec3 light_ambient;
+    vec3 light_diffuse;
+    bool proceduralStickers;
+};
+
+// the turning layer: cubes whose grid coordinate along turnAxis equals
+// turnLayer (every cube if negative) are rotated by turnPivot
+uniform int turnAxis;    // RotateState, 3 when nothing turns
+uniform int turnLayer;
+uniform mat4 turnPivot;
 
 void main(){
-    gl_Position = perspective * view * model * vec4(inPos, 1.0f);
-    texCoords = inTexCoords;
-    fragNorm = normModel * inNorm;
-    fragPos = vec3(model * vec4(inPos, 1.0f));
+    bool turning = turnAxis < 3 && (turnLayer < 0 || int(grid[turnAxis]) == turnLayer);
+    mat4 world = turning ? turnPivot * model : model;
+
+    gl_Position = perspective * view * world * vec4(inPos, 1.0f);
+    texCoords = vec3(inTexCoords, float(faceTex));
+    faceColor = faceTex;
+    // face transforms are rotations, reflections & uniform scaling, normalized in the fragment shader
+    fragNorm = mat3(world) * inNorm;
+    fragPos = vec3(world * vec4(inPos, 1.0f));
 }
@@ -3,23 +3,57 @@
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtc/type_ptr.hpp>
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <deque>
 #include <iostream>
+#include <string>
+#include <thread>
+#ifdef _WIN32
+#include <fcntl.h>
+#include <io.h>
+#endif
 
 #include "shader.h"
 #include "camera.h"
 #include "magic_cube.h"
-#include "cube.h"
+#include "reduction.h"
+#include "batch_solver.h"
+#include "parallel_search.h"
+#include "move_queue.h"
+#include "offscreen_renderer.h"
+#include "headless_context.h"
+
+#define STB_IMAGE_IMPLEMENTATION
+#include "stb_image.h"
 
 void framebuffer_size_callback(GLFWwindow *window, int width, int height);
 void scroll_callback(GLFWwindow* window, double x_offset, double y_offset);
 void mouse_button_callback(GLFWwindow* window, int button, int action, int mods);
 void mouse_callback(GLFWwindow* window, double xpos, double ypos);
+void refresh_callback(GLFWwindow* window);
+void key_callback(GLFWwindow* window, int key, int scancode, int action, int mods);
 void processInput(GLFWwindow *window);
+void solveMagicCube();
+void updatePlayback(float delta_time);
+bool animating();
+int runBatch(int argc, char *argv[]);
+int runOptimal(int argc, char *argv[]);
+int runCube2(int argc, char *argv[]);
+int runRender(int argc, char *argv[]);
+bool createHiddenContext();
+bool loadTextures(MagicCube& cube);
+bool applyStartOptions(int argc, char *argv[]);
 
 // settings
 unsigned int SCR_WIDTH = 800;
 unsigned int SCR_HEIGHT = 600;
 const unsigned int NUM_TEXTURES = 7;
+const char* TEXTURE_PACK_PATH = "./images/faces.tex";
+const int MIN_RANK = 2;
+const int MAX_RANK = 100;
 
 Camera cam(glm::vec3(2.6f, 2.6f, 2.0f), glm::vec3(0.6f, 0.6f, -0.6f), (GLfloat)SCR_WIDTH / (GLfloat)SCR_HEIGHT);
 HitRecord rec;
@@ -30,20 +64,58 @@ const glm::vec2 scr_axis[3] = {glm::normalize(glm::vec2(-1.2f, 1.0f)),
 							   glm::normalize(glm::vec2(-1.2f, -1.0f))};
 RotateState rotate_state = ROTATE_NONE;
 RotateMode  rotate_mode;
-RotateLayer rotate_layer;
+int rotate_layer;
 
 double press_xpos, press_ypos;
 bool mouse_pressed;
 float rotate_angle = 0;
 
+// Solver related, tables are loaded on the first solve
+const char* SOLVER_TABLES_PATH = "./two_phase.tbl";
+const char* CORNER_TABLE_PATH = "./corners.tbl";
+const float PLAYBACK_SPEED = 4.0f; // quarter turns per second
+const float MIN_PLAYBACK_SPEED = 0.5f;
+const float MAX_PLAYBACK_SPEED = 64.0f;
+TwoPhaseTables solver_tables;
+MoveQueue playback(PLAYBACK_SPEED);
+
+// Frame pacing: in event-driven mode a frame is drawn only when something
+// changed, the playback queue is animating or the light varies; otherwise
+// the loop sleeps in glfwWaitEvents
+bool event_driven = true;
+bool vsync = true;
+int max_fps = 0; // 0 for no limit besides vsync
+bool needs_redraw = true;
+
+// Stickers drawn from the face textures, or computed in the fragment shader
+bool procedural_stickers = false;
+// Faces drawn instanced, or from one merged vertex buffer
+MeshMode mesh_mode = MESH_INSTANCED;
+
 // Lighting related
 enum LightMode {LIGHT_NONE, LIGHT_NORMAL, LIGHT_VARY};
 LightMode light_mode = LIGHT_NONE;
 glm::vec3 light_ambient;
 glm::vec3 light_diffuse;
 
-int main()
+int main(int argc, char *argv[])
 {
+	// batch mode: solve scrambles from stdin, no window
+	// --------------------------------------------------
+	if(argc > 1 && std::string(argv[1]) == "--batch")
+		return runBatch(argc, argv);
+	// optimal mode: fewest face turns for each scramble from stdin, on every core
+	if(argc > 1 && std::string(argv[1]) == "--optimal")
+		return runOptimal(argc, argv);
+	// distance distribution of the 2x2x2, no window
+	if(argc > 1 && std::string(argv[1]) == "--cube2")
+		return runCube2(argc, argv);
+	// render mode: one image per scramble from stdin, no visible window
+	if(argc > 1 && std::string(argv[1]) == "--render")
+		return runRender(argc, argv);
+	if(!applyStartOptions(argc, argv))
+		return 1;
+
 	// glfw: initialize and configure
 	// ------------------------------
 	glfwInit();
@@ -68,6 +140,9 @@ int main()
 	glfwSetScrollCallback(window, scroll_callback);
 	glfwSetMouseButtonCallback(window, mouse_button_callback);
 	glfwSetCursorPosCallback(window, mouse_callback);
+	glfwSetKeyCallback(window, key_callback);
+	glfwSetWindowRefreshCallback(window, refresh_callback);
+	glfwSwapInterval(vsync ? 1 : 0);
 	// glad: load all OpenGL function pointers
 	// ---------------------------------------
 	if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress))
@@ -77,30 +152,52 @@ int main()
 	}
 	// load textures and configure magicCube
 	// -------------------------------------
-	std::string texPaths[NUM_TEXTURES] = {"./images/black.png",   "./images/green.png",  "./images/orange.png", "./images/red.png", 
-										  "./images/skyblue.png", "./images/yellow.png", "./images/white.png" };
-	magicCube.loadTextures(NUM_TEXTURES, texPaths);
+	if(!loadTextures(magicCube))
+	{
+		glfwTerminate();
+		return -1;
+	}
+	magicCube.setTextured(!procedural_stickers);
+	magicCube.setMeshMode(mesh_mode);
 	// load shader programs
 	// --------------------
 	Shader shader("./shader/vertex.glsl", "./shader/fragment.glsl");
 	shader.Use();
-	shader.setVec3("cameraPos", cam.getPosition());
-	shader.setVec3("lightPos", cam.getPosition());
-	// configure MVP matrices
-	// ----------------------
-	glm::mat4 view, perspective;
-	view = cam.getView();
-	shader.setMat4("view", view);
+	shader.bindUniformBlock("FrameData", FRAME_UNIFORMS_BINDING);
+	// configure per-frame uniforms, uploaded once per frame as a whole
+	// ----------------------------------------------------------------
+	UniformBuffer<FrameUniforms> frameBuffer(FRAME_UNIFORMS_BINDING);
+	FrameUniforms frame;
+	frame.view = cam.getView();
+	frame.cameraPos = glm::vec4(cam.getPosition(), 1.0f);
+	frame.lightPos = glm::vec4(cam.getPosition(), 1.0f);
 	// --------------
 	glEnable(GL_DEPTH_TEST);
 	glEnable(GL_MULTISAMPLE);
 	// render loop
 	// -----------
+	double last_frame = glfwGetTime();
+	std::chrono::steady_clock::time_point next_frame = std::chrono::steady_clock::now();
 	while (!glfwWindowShouldClose(window))
 	{
+		// glfw: poll IO events (keys pressed/released, mouse moved etc.), or wait for them when idle
+		// -------------------------------------------------------------------------------------------
+		if(!animating() && !needs_redraw){
+			glfwWaitEvents();
+			// time spent waiting does not count towards animations started by the events
+			last_frame = glfwGetTime();
+		}
+		else glfwPollEvents();
+
+		double current_frame = glfwGetTime();
+		float delta_time = current_frame - last_frame;
+		last_frame = current_frame;
 		// input
 		// -----
 		processInput(window);
+		updatePlayback(delta_time);
+		if(!animating() && !needs_redraw) continue;
+		needs_redraw = false;
 
 		// render
 		// ------
@@ -123,22 +220,26 @@ int main()
 				light_ambient = light_diffuse * glm::vec3(0.4f);
 				break;
 		}
-		shader.setVec3("light_ambient", light_ambient);
-		shader.setVec3("light_diffuse", light_diffuse);
+		frame.light_ambient = glm::vec4(light_ambient, 1.0f);
+		frame.light_diffuse = light_diffuse;
+		frame.proceduralStickers = procedural_stickers;
+		frame.perspective = cam.getPerspective();
+		frameBuffer.update(frame);
 
-		perspective = cam.getPerspective();
-		shader.setMat4("perspective", perspective);
-		
 		magicCube.draw(shader, rotate_state, rotate_layer, rotate_angle);
 
-		// glfw: swap buffers and poll IO events (keys pressed/released, mouse moved etc.)
-		// -------------------------------------------------------------------------------
+		// glfw: swap buffers, then hold the frame rate under max_fps
+		// ----------------------------------------------------------
 		glfwSwapBuffers(window);
-		glfwPollEvents();
+		if(max_fps > 0){
+			next_frame = std::max(next_frame + std::chrono::microseconds(1000000 / max_fps), std::chrono::steady_clock::now());
+			std::this_thread::sleep_until(next_frame);
+		}
 	}
 	// glfw: terminate, clearing all previously allocated GLFWresources.
 	//---------------------------------------------------------------
-	//cube.finishDrawing();
+	frameBuffer.release();
+	magicCube.finishDrawing();
 	glfwTerminate();
 	return 0;
 }
@@ -147,17 +248,8 @@ void processInput(GLFWwindow *window)
 {
 	if(glfwGetKey(window, GLFW_KEY_ESCAPE) == GLFW_PRESS)
 		glfwSetWindowShouldClose(window, true);
-	if(glfwGetKey(window, GLFW_KEY_2) == GLFW_PRESS)
-		magicCube.setRank(2);
-	if(glfwGetKey(window, GLFW_KEY_3) == GLFW_PRESS)
-		magicCube.setRank(3);
-	if(glfwGetKey(window, GLFW_KEY_4) == GLFW_PRESS)
-		magicCube.setRank(4);
-	if(glfwGetKey(window, GLFW_KEY_5) == GLFW_PRESS)
-		magicCube.setRank(5);
-	if(glfwGetKey(window, GLFW_KEY_6) == GLFW_PRESS)
-		magicCube.setRank(6);
-	
+	LightMode mode = light_mode;
+
 	// change lighting mode
 	if(glfwGetKey(window, GLFW_KEY_Z) == GLFW_PRESS)
 		light_mode = LIGHT_NONE;
@@ -165,6 +257,463 @@ void processInput(GLFWwindow *window)
 		light_mode = LIGHT_NORMAL;
 	if(glfwGetKey(window, GLFW_KEY_C) == GLFW_PRESS)
 		light_mode = LIGHT_VARY;
+	if(mode != light_mode)
+		needs_redraw = true;
+}
+
+// solve the magic cube and queue the solution for playback
+// ---------------------------------------------------------
+void solveMagicCube()
+{
+	if(!solver_tables.ready()){
+		std::cout << "Loading solver tables from " << SOLVER_TABLES_PATH << std::endl;
+		if(!solver_tables.loadOrGenerate(SOLVER_TABLES_PATH))
+			std::cerr << "Failed to save solver tables to " << SOLVER_TABLES_PATH << std::endl;
+	}
+	std::vector<Move> moves;
+	ReductionSolver solver(solver_tables);
+	if(!solver.solve(magicCube.getState(), moves)){
+		std::cerr << "Failed to solve the magic cube." << std::endl;
+		return;
+	}
+	std::cout << "Solution (" << moves.size() << " moves): " << formatMoves(moves, magicCube.getRank()) << std::endl;
+	playback.push(moves, magicCube.getRank());
+}
+
+// start position of the interactive mode
+// usage: [--rank N] [--moves "<sequence>"] [--play "<sequence>"], sequences in WCA / SiGN notation
+//        [--vsync 0|1] [--max-fps N] [--redraw event|continuous] [--stickers texture|procedural]
+//        [--mesh instanced|merged]
+// --moves sets up the cube at once, --play animates the sequence afterwards
+// ------------------------------------------------------------------------------------------------
+bool applyStartOptions(int argc, char *argv[])
+{
+	std::string sequence, animated;
+	for(int ix = 1; ix < argc; ix += 2){
+		std::string flag = argv[ix];
+		int value = ix + 1 < argc ? std::atoi(argv[ix + 1]) : 0;
+		if(flag == "--rank" && value >= MIN_RANK && value <= MAX_RANK) magicCube.setRank(value);
+		else if(flag == "--moves" && ix + 1 < argc) sequence = argv[ix + 1];
+		else if(flag == "--play" && ix + 1 < argc) animated = argv[ix + 1];
+		else if(flag == "--vsync" && ix + 1 < argc) vsync = value != 0;
+		else if(flag == "--max-fps" && ix + 1 < argc && value >= 0) max_fps = value;
+		else if(flag == "--redraw" && ix + 1 < argc && (std::string(argv[ix + 1]) == "event" || std::string(argv[ix + 1]) == "continuous"))
+			event_driven = std::string(argv[ix + 1]) == "event";
+		else if(flag == "--stickers" && ix + 1 < argc && (std::string(argv[ix + 1]) == "texture" || std::string(argv[ix + 1]) == "procedural"))
+			procedural_stickers = std::string(argv[ix + 1]) == "procedural";
+		else if(flag == "--mesh" && ix + 1 < argc && (std::string(argv[ix + 1]) == "instanced" || std::string(argv[ix + 1]) == "merged"))
+			mesh_mode = std::string(argv[ix + 1]) == "merged" ? MESH_MERGED : MESH_INSTANCED;
+		else{
+			std::cerr << "Usage: " << argv[0] << " [--rank N] [--moves \"<sequence>\"] [--play \"<sequence>\"]"
+					  << " [--vsync 0|1] [--max-fps N] [--redraw event|continuous] [--stickers texture|procedural]"
+					  << " [--mesh instanced|merged]" << std::endl;
+			return false;
+		}
+	}
+
+	std::vector<Move> moves, played;
+	if(!parseMoves(sequence, magicCube.getRank(), moves) || !parseMoves(animated, magicCube.getRank(), played))
+		return false;
+	magicCube.apply(CompiledMoves(magicCube.getRank(), moves));
+	playback.push(played, magicCube.getRank());
+	return true;
+}
+
+// solve one scramble per line of stdin, solutions go to stdout in input order
+// usage: --batch [--rank N] [--threads N] [--window N]
+// ----------------------------------------------------------------------------
+int runBatch(int argc, char *argv[])
+{
+	int rank = 3, threads = 0, window = 1024;
+	for(int ix = 2; ix < argc; ix += 2){
+		std::string flag = argv[ix];
+		int value = ix + 1 < argc ? std::atoi(argv[ix + 1]) : 0;
+		if(flag == "--rank" && value >= MIN_RANK && value <= MAX_RANK) rank = value;
+		else if(flag == "--threads" && value > 0) threads = value;
+		else if(flag == "--window" && value > 0) window = value;
+		else{
+			std::cerr << "Usage: " << argv[0] << " --batch [--rank N] [--threads N] [--window N]" << std::endl;
+			return 1;
+		}
+	}
+
+	if(!solver_tables.loadOrGenerate(SOLVER_TABLES_PATH))
+		std::cerr << "Failed to save solver tables to " << SOLVER_TABLES_PATH << std::endl;
+
+	std::ios::sync_with_stdio(false);
+	ThreadPool pool(threads);
+	BatchSolver solver(solver_tables, pool, rank, window);
+	BatchSolver::Stats stats = solver.run(std::cin, std::cout);
+
+	std::cerr << "Solved " << stats.solved << " scrambles (" << stats.failed << " failed) in "
+			  << stats.seconds << " s with " << pool.size() << " threads: "
+			  << stats.throughput() << " solves/s, p50 " << stats.p50_ms << " ms, p99 " << stats.p99_ms << " ms" << std::endl;
+	return stats.failed == 0 ? 0 : 1;
+}
+
+// optimal solution of one 3x3x3 scramble per line of stdin, to stdout in input order
+// usage: --optimal [--threads N] [--split N] [--max N]
+// the search of each scramble is spread over the threads, split at depth --split;
+// the corner table (44 MB) is built on the first run and memory-mapped afterwards
+// ------------------------------------------------------------------------------------
+int runOptimal(int argc, char *argv[])
+{
+	int threads = 0, split_depth = 3, max_length = 20;
+	for(int ix = 2; ix < argc; ix += 2){
+		std::string flag = argv[ix];
+		int value = ix + 1 < argc ? std::atoi(argv[ix + 1]) : 0;
+		if(flag == "--threads" && value > 0) threads = value;
+		else if(flag == "--split" && value > 0) split_depth = value;
+		else if(flag == "--max" && value > 0) max_length = value;
+		else{
+			std::cerr << "Usage: " << argv[0] << " --optimal [--threads N] [--split N] [--max N]" << std::endl;
+			return 1;
+		}
+	}
+
+	std::ios::sync_with_stdio(false);
+	ThreadPool pool(threads);
+	CornerTable corners;
+	if(!solver_tables.loadOrGenerate(SOLVER_TABLES_PATH))
+		std::cerr << "Failed to save solver tables to " << SOLVER_TABLES_PATH << std::endl;
+	if(!corners.loadOrGenerate(CORNER_TABLE_PATH, pool))
+		std::cerr << "Failed to save the corner table to " << CORNER_TABLE_PATH << std::endl;
+
+	OptimalSolver solver(solver_tables, corners, pool, split_depth);
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	std::uint64_t nodes = 0;
+	std::size_t line_number = 0, solved = 0, failed = 0;
+	std::string scramble;
+	while(std::getline(std::cin, scramble)){
+		++line_number;
+		std::vector<Move> moves;
+		CubeState state(3);
+		CubieCube cube;
+		std::vector<int> solution;
+		bool ok = parseMoves(scramble, 3, moves);
+		if(ok){
+			applyMoves(state, moves);
+			ok = CubieCube::fromState(state, cube) && solver.solve(cube, solution, max_length);
+			nodes += solver.visited();
+		}
+		moves.clear();
+		for(int m : solution) moves.push_back(CubieCube::toMove(m));
+		std::cout << (ok ? formatMoves(moves, 3) : "") << std::endl;
+		if(ok) ++solved;
+		else{
+			std::cerr << "No solution for line " << line_number << "." << std::endl;
+			++failed;
+		}
+	}
+
+	double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	std::cerr << "Solved " << solved << " scrambles optimally (" << failed << " failed) in " << seconds
+			  << " s with " << pool.size() << " threads: " << nodes << " nodes, "
+			  << (seconds > 0 ? nodes / seconds : 0) << " nodes/s" << std::endl;
+	return failed == 0 ? 0 : 1;
+}
+
+// number of 2x2x2 states at each distance from solved, the last one is God's number
+// usage: --cube2 [--threads N] [--metric htm|qtm]
+// --------------------------------------------------------------------------------------
+int runCube2(int argc, char *argv[])
+{
+	int threads = 0;
+	bool quarter_turns = false;
+	for(int ix = 2; ix < argc; ix += 2){
+		std::string flag = argv[ix];
+		std::string value = ix + 1 < argc ? argv[ix + 1] : "";
+		if(flag == "--threads" && std::atoi(value.c_str()) > 0) threads = std::atoi(value.c_str());
+		else if(flag == "--metric" && (value == "htm" || value == "qtm")) quarter_turns = value == "qtm";
+		else{
+			std::cerr << "Usage: " << argv[0] << " --cube2 [--threads N] [--metric htm|qtm]" << std::endl;
+			return 1;
+		}
+	}
+
+	ThreadPool pool(threads);
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	std::vector<std::uint64_t> counts = enumerateCube2(pool, quarter_turns);
+	double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+	std::uint64_t total = 0;
+	for(std::size_t d = 0; d != counts.size(); ++d){
+		std::cout << d << "\t" << counts[d] << std::endl;
+		total += counts[d];
+	}
+	std::cerr << total << " states, God's number " << counts.size() - 1 << (quarter_turns ? " (quarter turns)" : " (face turns)")
+			  << ", in " << seconds << " s with " << pool.size() << " threads" << std::endl;
+	return 0;
+}
+
+// face textures, baked on the first run and memory-mapped afterwards
+// ------------------------------------------------------------------
+bool loadTextures(MagicCube& cube)
+{
+	std::string texPaths[NUM_TEXTURES] = {"./images/black.png",   "./images/green.png",  "./images/orange.png", "./images/red.png", 
+										  "./images/skyblue.png", "./images/yellow.png", "./images/white.png" };
+	TexturePack textures;
+	if(!textures.loadOrBake(TEXTURE_PACK_PATH, NUM_TEXTURES, texPaths))
+	{
+		std::cout << "Failed to load textures" << std::endl;
+		return false;
+	}
+	cube.loadTextures(textures);
+	return true;
+}
+
+// render one image per scramble of stdin, e.g. thumbnails for a puzzle database
+// usage: --render [--rank N] [--size N] [--samples N] [--out DIR|-] [--stickers texture|procedural]
+//        [--mesh instanced|merged] [--context window|egl]
+// images go to DIR/<line>.ppm, or as one stream of PPM images to stdout with --out -
+// --context window: the context comes from a hidden GLFW window, which still needs
+//   a display server (X11, Wayland or Xvfb)
+// --context egl: a surfaceless EGL context, no display server at all, e.g. Mesa
+//   llvmpipe on a server without a GPU; only if built with MAGIC_CUBE_EGL, the default then
+// ------------------------------------------------------------------------------------
+int runRender(int argc, char *argv[])
+{
+	int rank = 3, size = 256, samples = 4;
+	std::string out = ".";
+#ifdef MAGIC_CUBE_EGL
+	bool use_egl = true;
+#else
+	bool use_egl = false;
+#endif
+	for(int ix = 2; ix < argc; ix += 2){
+		std::string flag = argv[ix];
+		std::string value = ix + 1 < argc ? argv[ix + 1] : "";
+		int number = std::atoi(value.c_str());
+		if(flag == "--rank" && number >= MIN_RANK && number <= MAX_RANK) rank = number;
+		else if(flag == "--size" && number > 0) size = number;
+		else if(flag == "--samples" && ix + 1 < argc && number >= 0) samples = number;
+		else if(flag == "--out" && !value.empty()) out = value;
+		else if(flag == "--stickers" && (value == "texture" || value == "procedural")) procedural_stickers = value == "procedural";
+		else if(flag == "--mesh" && (value == "instanced" || value == "merged")) mesh_mode = value == "merged" ? MESH_MERGED : MESH_INSTANCED;
+		else if(flag == "--context" && (value == "window" || value == "egl")) use_egl = value == "egl";
+		else{
+			std::cerr << "Usage: " << argv[0] << " --render [--rank N] [--size N] [--samples N] [--out DIR|-]"
+					  << " [--stickers texture|procedural] [--mesh instanced|merged] [--context window|egl]" << std::endl;
+			return 1;
+		}
+	}
+#ifndef MAGIC_CUBE_EGL
+	if(use_egl){
+		std::cerr << "Built without EGL support, define MAGIC_CUBE_EGL and link with -lEGL" << std::endl;
+		return 1;
+	}
+#endif
+
+	// the GL context, frames go to a framebuffer object either way
+	// --------------------------------------------------------------
+#ifdef MAGIC_CUBE_EGL
+	// destroyed last, after every GL object below
+	HeadlessContext headless;
+	if(use_egl){
+		if(!headless.create()) return -1;
+		if (!gladLoadGLLoader((GLADloadproc)HeadlessContext::getProcAddress))
+		{
+			std::cerr << "Failed to initialize GLAD" << std::endl;
+			return -1;
+		}
+	}
+#endif
+	if(!use_egl && !createHiddenContext())
+		return -1;
+
+	OffscreenRenderer target;
+	MagicCube cube(rank);
+	if(!target.init(size, size, samples) || !loadTextures(cube))
+	{
+		target.release();
+		cube.finishDrawing();
+		if(!use_egl) glfwTerminate();
+		return -1;
+	}
+	cube.setTextured(!procedural_stickers);
+	cube.setMeshMode(mesh_mode);
+
+	// the same shaders & camera as the interactive mode, with a square image
+	// ---------------------------------------------------------------------
+	Shader shader("./shader/vertex.glsl", "./shader/fragment.glsl");
+	shader.Use();
+	shader.bindUniformBlock("FrameData", FRAME_UNIFORMS_BINDING);
+	UniformBuffer<FrameUniforms> frameBuffer(FRAME_UNIFORMS_BINDING);
+	Camera view(glm::vec3(2.6f, 2.6f, 2.0f), glm::vec3(0.6f, 0.6f, -0.6f), 1.0f);
+	FrameUniforms frame;
+	frame.view = view.getView();
+	frame.perspective = view.getPerspective();
+	frame.cameraPos = glm::vec4(view.getPosition(), 1.0f);
+	frame.lightPos = glm::vec4(view.getPosition(), 1.0f);
+	frame.light_ambient = glm::vec4(glm::vec3(0.4f), 1.0f);
+	frame.light_diffuse = glm::vec3(1.0f);
+	frame.proceduralStickers = procedural_stickers;
+	frameBuffer.update(frame);
+	glEnable(GL_DEPTH_TEST);
+
+	bool to_stdout = out == "-";
+#ifdef _WIN32
+	if(to_stdout) _setmode(_fileno(stdout), _O_BINARY);
+#endif
+
+	// draw while earlier frames are read back, frames come back in input order
+	// -------------------------------------------------------------------------
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	std::deque<std::size_t> in_flight; // input line of each queued frame
+	std::vector<std::uint8_t> pixels;
+	std::size_t line_number = 0, rendered = 0, failed = 0;
+	auto writeOldest = [&]{
+		std::size_t line = in_flight.front();
+		in_flight.pop_front();
+		bool ok = target.popFrame(pixels) &&
+				  (to_stdout ? writePPM(stdout, size, size, pixels) : writePPM(out + "/" + std::to_string(line) + ".ppm", size, size, pixels));
+		if(ok) ++rendered;
+		else{
+			std::cerr << "Failed to write the image of line " << line << "." << std::endl;
+			++failed;
+		}
+	};
+
+	std::string scramble;
+	std::vector<Move> moves;
+	while(std::getline(std::cin, scramble)){
+		++line_number;
+		moves.clear();
+		if(!parseMoves(scramble, rank, moves)){
+			std::cerr << "Invalid scramble on line " << line_number << "." << std::endl;
+			++failed;
+			continue;
+		}
+		CubeState state(rank);
+		CompiledMoves(rank, moves).apply(state);
+		cube.setState(state);
+
+		if(target.full()) writeOldest();
+		target.beginFrame(glm::vec4(0.2f, 0.3f, 0.3f, 1.0f));
+		cube.draw(shader, ROTATE_NONE, LAYER_NONE, 0);
+		target.endFrame();
+		in_flight.push_back(line_number);
+	}
+	while(!in_flight.empty()) writeOldest();
+	if(to_stdout) std::fflush(stdout);
+
+	double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	std::cerr << "Rendered " << rendered << " images (" << failed << " failed) of " << size << "x" << size
+			  << " in " << seconds << " s: " << (seconds > 0 ? 60 * rendered / seconds : 0) << " images/min" << std::endl;
+
+	target.release();
+	frameBuffer.release();
+	cube.finishDrawing();
+	if(!use_egl) glfwTerminate();
+	return failed == 0 ? 0 : 1;
+}
+
+// glfw: a hidden window only for its GL context, still needs a display server
+// ------------------------------------------------------------------------------
+bool createHiddenContext()
+{
+	glfwInit();
+	glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+	glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+	glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+	glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+#ifdef __APPLE__
+	glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
+#endif
+	GLFWwindow *window = glfwCreateWindow(1, 1, "Magic Cube", NULL, NULL);
+	if (window == NULL)
+	{
+		std::cerr << "Failed to create an OpenGL context" << std::endl;
+		glfwTerminate();
+		return false;
+	}
+	glfwMakeContextCurrent(window);
+	if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress))
+	{
+		std::cerr << "Failed to initialize GLAD" << std::endl;
+		glfwTerminate();
+		return false;
+	}
+	return true;
+}
+
+// animate the playback queue, committing every move that finished
+// ------------------------------------------------------------------
+void updatePlayback(float delta_time)
+{
+	if(mouse_pressed) return;
+
+	std::vector<Move> finished;
+	playback.update(delta_time, finished);
+	if(!finished.empty()){
+		magicCube.apply(finished);
+		needs_redraw = true; // show the last move committed even once the queue is empty
+	}
+	if(!playback.current(rotate_state, rotate_layer, rotate_angle)){
+		rotate_state = ROTATE_NONE;
+		rotate_angle = 0;
+	}
+}
+
+// whether frames have to be drawn continuously
+// --------------------------------------------
+bool animating()
+{
+	return !event_driven || !playback.empty() || light_mode == LIGHT_VARY;
+}
+
+// glfw: 2 ~ 6 select the rank of the magic cube, +/- step it; S solves it
+// playback: F skips to the end, P toggles pipelining, [ and ] change the speed
+// T switches between textured & procedural stickers
+// ---------------------------------------------------------------------------
+void key_callback(GLFWwindow*, int key, int, int action, int)
+{
+	if(action != GLFW_PRESS && action != GLFW_REPEAT) return;
+	if(mouse_pressed) return; // do not interrupt a rotation
+	needs_redraw = true;
+
+	if(action == GLFW_PRESS){
+		if(key == GLFW_KEY_F){
+			// commit every queued move in one pass, no frame is drawn in between
+			std::vector<Move> finished;
+			playback.fastForward(finished);
+			magicCube.apply(CompiledMoves(magicCube.getRank(), finished));
+			rotate_state = ROTATE_NONE;
+			rotate_angle = 0;
+			return;
+		}
+		if(key == GLFW_KEY_T){
+			procedural_stickers = !procedural_stickers;
+			magicCube.setTextured(!procedural_stickers);
+			return;
+		}
+		if(key == GLFW_KEY_P){
+			playback.setPipelined(!playback.isPipelined());
+			std::cout << "Pipelined playback " << (playback.isPipelined() ? "on" : "off") << std::endl;
+			return;
+		}
+	}
+	if(key == GLFW_KEY_LEFT_BRACKET || key == GLFW_KEY_RIGHT_BRACKET){
+		float speed = playback.getSpeed() * (key == GLFW_KEY_RIGHT_BRACKET ? 2.0f : 0.5f);
+		playback.setSpeed(std::min(std::max(speed, MIN_PLAYBACK_SPEED), MAX_PLAYBACK_SPEED));
+		std::cout << "Playback speed " << playback.getSpeed() << " quarter turns per second" << std::endl;
+		return;
+	}
+	if(!playback.empty()) return; // keep the cube while moves are played
+
+	if(key == GLFW_KEY_S){
+		if(action == GLFW_PRESS) solveMagicCube();
+		return;
+	}
+
+	int rank = magicCube.getRank();
+	if(key == GLFW_KEY_EQUAL || key == GLFW_KEY_KP_ADD) rank += 1;
+	else if(key == GLFW_KEY_MINUS || key == GLFW_KEY_KP_SUBTRACT) rank -= 1;
+	else if(key >= GLFW_KEY_2 && key <= GLFW_KEY_6 && action == GLFW_PRESS) rank = key - GLFW_KEY_0;
+	else return;
+
+	rank = std::min(std::max(rank, MIN_RANK), MAX_RANK);
+	if(rank != magicCube.getRank()) magicCube.setRank(rank);
 }
 
 // glfw: whenever the window size changed (by OS or user resize) this callback function executes
@@ -174,6 +723,7 @@ void framebuffer_size_callback(GLFWwindow *window, int width, int height)
 	// make sure the viewport matches the new window dimensions; note that width and
 	// height will be significantly larger than specified on retina displays.
 	glViewport(0, 0, width, height);
+	needs_redraw = true;
 	SCR_WIDTH = width;
 	SCR_HEIGHT = height;
 	if(SCR_HEIGHT != 0){
@@ -185,8 +735,10 @@ void framebuffer_size_callback(GLFWwindow *window, int width, int height)
 void mouse_button_callback(GLFWwindow* window, int button, int action, int mods){
 	double x_offset, y_offset;
 	float u, v;
+	needs_redraw = true;
 	if(button == GLFW_MOUSE_BUTTON_LEFT){
 		if(action == GLFW_PRESS){
+			if(!playback.empty()) return; // the solution is being played
 			glfwGetCursorPos(window, &press_xpos, &press_ypos);
 			u = press_xpos / SCR_WIDTH;
 			v = 1 - press_ypos / SCR_HEIGHT;
@@ -194,23 +746,17 @@ void mouse_button_callback(GLFWwindow* window, int button, int action, int mods)
 			glm::vec3 cam_pos = cam.getPosition();
 			Ray ray(cam_pos, glm::normalize(target - cam_pos));
 
-			if(magicCube.hit(ray, 1e-5, 100.0f, rec)) 
+			if(magicCube.hit(ray, 1e-5, 100.0f, rec, rotate_state, rotate_layer, rotate_angle)) 
 				rotate_mode = ROTATE_LOCAL;
 			else 
 				rotate_mode = ROTATE_GLOBAL;
 
 			mouse_pressed = true;
 		}
-		if(action == GLFW_RELEASE){
+		if(action == GLFW_RELEASE && mouse_pressed){
 			mouse_pressed = false;
-			int num_rotates = rotate_angle / 90.0;
-			if(fabs(rotate_angle - 90.0 * num_rotates) > 45.0){
-				if(rotate_angle < 0) num_rotates -= 1;
-				else num_rotates += 1;
-			}
-			magicCube.rotate(rotate_state, rotate_layer, num_rotates * 90.0f);
-			rotate_angle = 0;
-			rotate_state = ROTATE_NONE;
+			// let the layer turn on to the nearest quarter turn instead of jumping there
+			playback.settle(rotate_state, rotate_layer, rotate_angle);
 		}
 	}
 }
@@ -321,6 +867,7 @@ void local_rotate(glm::vec2 mouse_offset, const HitRecord& rec){
 
 void mouse_callback(GLFWwindow* window, double xpos, double ypos){	
 	if(!mouse_pressed) return;
+	needs_redraw = true;
 	
 	glm::vec2 offset(xpos - press_xpos, ypos - press_ypos);
 	if(rotate_mode == ROTATE_GLOBAL) global_rotate(offset);
@@ -333,4 +880,10 @@ void mouse_callback(GLFWwindow* window, double xpos, double ypos){
 
 void scroll_callback(GLFWwindow* window, double x_offset, double y_offset){
 	cam.onZooming(y_offset);
+	needs_redraw = true;
+}
+
+// glfw: the window contents were damaged, e.g. uncovered by another window
+void refresh_callback(GLFWwindow*){
+	needs_redraw = true;
 }
@@ -0,0 +1,28 @@
+#ifndef CHECK_H_
+#define CHECK_H_
+
+#include <iostream>
+
+/*
+ * Minimal checks for the core tests: a failed CHECK reports the file, line
+ * and condition and the test keeps going, main returns checkResult().
+ */
+inline int& checkFailures(){
+    static int failures = 0;
+    return failures;
+}
+
+#define CHECK(cond) \
+    do{ \
+        if(!(cond)){ \
+            std::cerr << __FILE__ << ":" << __LINE__ << ": CHECK(" #cond ") failed" << std::endl; \
+            ++checkFailures(); \
+        } \
+    }while(0)
+
+inline int checkResult(){
+    if(checkFailures()) std::cerr << checkFailures() << " check(s) failed" << std::endl;
+    return checkFailures() == 0 ? 0 : 1;
+}
+
+#endif
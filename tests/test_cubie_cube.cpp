@@ -0,0 +1,118 @@
+// CubieCube against the facelet model it is derived from
+#include <cstdint>
+#include <random>
+#include <vector>
+
+#include "cube_state.h"
+#include "cube_moves.h"
+#include "cubie_cube.h"
+#include "two_phase.h"
+#include "check.h"
+
+// the same face turns on a CubieCube and on a rank 3 CubeState
+void checkSameTurns(const std::vector<int>& turns){
+    CubieCube cube;
+    CubeState state(3);
+    for(int m : turns){
+        cube.move(m);
+        applyMove(state, CubieCube::toMove(m));
+    }
+    CubieCube read;
+    CHECK(CubieCube::fromState(state, read));
+    CHECK(read == cube);
+    CHECK(cube.toState() == state);
+    CHECK(cube.solved() == state.solved());
+}
+
+void testSingleTurns(){
+    for(int m = 0; m != CubieCube::NUM_MOVES; ++m){
+        checkSameTurns({m});
+        // a quarter turn has order 4, a half turn order 2
+        CubieCube cube;
+        for(int k = 0; k != (m % 3 == 1 ? 2 : 4); ++k){
+            CHECK(k == 0 || !cube.solved());
+            cube.move(m);
+        }
+        CHECK(cube.solved());
+        // every turn is undone by its inverse
+        cube.move(m);
+        cube.move(m / 3 * 3 + 2 - m % 3);
+        CHECK(cube.solved());
+    }
+}
+
+void testRandomSequences(){
+    std::mt19937 rng(17);
+    for(int k = 0; k != 200; ++k){
+        std::vector<int> turns(1 + rng() % 60);
+        for(int& m : turns) m = int(rng() % CubieCube::NUM_MOVES);
+        checkSameTurns(turns);
+
+        // a whole sequence at once matches one turn at a time
+        std::vector<std::uint8_t> packed(turns.begin(), turns.end());
+        CubieCube batch, single;
+        batch.move(packed);
+        for(int m : turns) single.move(m);
+        CHECK(batch == single);
+        CHECK(CubeCoordinates::solvable(batch));
+    }
+}
+
+void testFromState(){
+    // faces are read by their centers, so a rotated solved cube is still solved
+    CubeState state(3);
+    std::vector<Move> moves;
+    CHECK(parseMoves("x y2 z'", 3, moves));
+    applyMoves(state, moves);
+    CubieCube rotated;
+    CHECK(CubieCube::fromState(state, rotated) && rotated.solved());
+    moves.clear();
+    CHECK(parseMoves("R U F'", 3, moves));
+    applyMoves(state, moves);
+    CHECK(CubieCube::fromState(state, rotated) && !rotated.solved() && CubeCoordinates::solvable(rotated));
+
+    // other ranks and impossible colorings are rejected
+    CubieCube cube;
+    CHECK(!CubieCube::fromState(CubeState(4), cube));
+    CubeState broken(3);
+    broken.setFacelet(broken.faceletIndex(FACE_TOP, 0, 0), broken.facelet(FACE_FRONT, 1, 1));
+    CHECK(!CubieCube::fromState(broken, cube));
+}
+
+void testCoordinates(){
+    typedef CubeCoordinates C;
+    for(int ix = 0; ix < C::N_TWIST; ix += 7){
+        CubieCube c;
+        C::setTwist(c, ix);
+        CHECK(C::getTwist(c) == ix);
+    }
+    for(int ix = 0; ix < C::N_FLIP; ix += 7){
+        CubieCube c;
+        C::setFlip(c, ix);
+        CHECK(C::getFlip(c) == ix);
+    }
+    for(int ix = 0; ix < C::N_SLICE; ++ix){
+        CubieCube c;
+        C::setSlice(c, ix);
+        CHECK(C::getSlice(c) == ix);
+    }
+    for(int ix = 0; ix < C::N_CPERM; ix += 97){
+        CubieCube c;
+        C::setCornerPerm(c, ix);
+        CHECK(C::getCornerPerm(c) == ix);
+    }
+    CHECK(C::getTwist(CubieCube()) == 0 && C::getFlip(CubieCube()) == 0);
+
+    // a single twisted corner can not be solved
+    CubieCube twisted;
+    twisted.setCorner(0, 0, 1);
+    CHECK(!C::solvable(twisted));
+}
+
+int main(){
+    testSingleTurns();
+    testRandomSequences();
+    testFromState();
+    testCoordinates();
+    return checkResult();
+}
@@ -0,0 +1,157 @@
+// Notation, simplification, scrambles & compiled moves of the puzzle core
+#include <random>
+#include <string>
+#include <vector>
+
+#include "cube_state.h"
+#include "cube_moves.h"
+#include "check.h"
+
+// parse text and format it back, empty if it does not parse
+std::string roundTrip(const std::string& text, int rank){
+    std::vector<Move> moves;
+    if(!parseMoves(text, rank, moves)) return "";
+    return formatMoves(moves, rank);
+}
+
+bool sameEffect(const std::string& a, const std::string& b, int rank){
+    std::vector<Move> ma, mb;
+    if(!parseMoves(a, rank, ma) || !parseMoves(b, rank, mb)) return false;
+    CubeState sa(rank), sb(rank);
+    applyMoves(sa, ma);
+    applyMoves(sb, mb);
+    return sa == sb;
+}
+
+void testParseFormat(){
+    // canonical text comes back unchanged
+    CHECK(roundTrip("R U R' U'", 3) == "R U R' U'");
+    CHECK(roundTrip("F2 B2 L D'", 3) == "F2 B2 L D'");
+    CHECK(roundTrip("x y' z2", 3) == "x y' z2");
+    CHECK(roundTrip("2F2 3R'", 5) == "2F2 3R'");
+    // wide & slice moves expand to single layers
+    CHECK(roundTrip("Rw", 3) == "R 2R");
+    CHECK(roundTrip("r", 4) == "R 2R");
+    CHECK(roundTrip("3Rw'", 5) == "R' 2R' 3R'");
+    CHECK(roundTrip("2-3Lw2", 5) == "2L2 3R2");
+    CHECK(roundTrip("M", 3) == "2R'");
+    CHECK(roundTrip("E2", 3) == "2U2");
+    CHECK(roundTrip("S", 3) == "2F");
+    CHECK(roundTrip("3Rw", 3) == "x");
+    CHECK(roundTrip("R2'", 3) == "R2");
+
+    // invalid tokens
+    std::vector<Move> moves;
+    const char* invalid[] = {"Q", "0R", "4R", "1x", "rw", "2-", "2-R", "99999999999R"};
+    for(const char* token : invalid) CHECK(!parseMoves(token, 3, moves));
+    CHECK(!parseMoves("M", 2, moves));
+    CHECK(!parseMoves("3-2R", 5, moves));
+    CHECK(parseMoves("", 3, moves) && moves.empty());
+
+    // the notation means the turns it names
+    CHECK(sameEffect("M", "R L' x'", 3));
+    CHECK(sameEffect("Rw", "Lw x", 4));
+    CHECK(sameEffect("R2 R2", "", 3));
+
+    // every single layer move of a few ranks survives a round trip
+    for(int rank = 2; rank <= 6; ++rank){
+        for(int axis = 0; axis != 3; ++axis){
+            for(int layer = LAYER_ALL; layer != rank; ++layer){
+                for(int quarters = 1; quarters != 4; ++quarters){
+                    Move move(RotateState(axis), layer, quarters);
+                    std::vector<Move> parsed;
+                    CHECK(parseMoves(formatMove(move, rank), rank, parsed));
+                    CHECK(parsed.size() == 1 && parsed[0] == move);
+                }
+            }
+        }
+    }
+    // layers outside the cube have no notation
+    CHECK(formatMove(Move(ROTATE_X, 3, 1), 3).empty());
+}
+
+void testSimplify(){
+    auto simplified = [](const std::string& text, int rank){
+        std::vector<Move> moves;
+        parseMoves(text, rank, moves);
+        return formatMoves(simplifyMoves(moves, rank), rank);
+    };
+    CHECK(simplified("R R'", 3) == "");
+    CHECK(simplified("U U U", 3) == "U'");
+    CHECK(simplified("R U U' R'", 3) == "");
+    CHECK(simplified("x x x x", 3) == "");
+    CHECK(simplified("R2 R2 F F2", 3) == "F'");
+    CHECK(sameEffect("R L R", simplified("R L R", 3), 3));
+    CHECK(sameEffect("x R'", simplified("x R'", 3), 3));
+
+    // random sequences keep their effect, get no longer, and are a fixed point
+    std::mt19937 rng(3);
+    for(int k = 0; k != 500; ++k){
+        int rank = 2 + k % 7;
+        std::vector<Move> moves;
+        for(int ix = 0; ix != 40; ++ix){
+            int layer = int(rng() % (rank + 1));
+            moves.emplace_back(RotateState(rng() % 3), layer == rank ? LAYER_ALL : layer, int(rng() % 7) - 3);
+        }
+        std::vector<Move> simple = simplifyMoves(moves, rank);
+        CubeState a(rank), b(rank);
+        applyMoves(a, moves);
+        applyMoves(b, simple);
+        CHECK(a == b);
+        CHECK(simple.size() <= moves.size());
+        CHECK(simplifyMoves(simple, rank).size() == simple.size());
+    }
+}
+
+void testScrambleVerify(){
+    std::mt19937 rng(11);
+    for(int rank = 2; rank <= 9; ++rank){
+        std::vector<Move> moves = scramble(rank, 30, rng);
+        CHECK(moves.size() == 30);
+        CubeState state(rank);
+        applyMoves(state, moves);
+        CHECK(!state.solved());
+
+        // undoing the scramble in reverse solves it
+        std::vector<Move> undo;
+        for(auto it = moves.rbegin(); it != moves.rend(); ++it)
+            undo.emplace_back(it->axis, it->layer, -it->quarters);
+        CHECK(verifySolution(state, undo));
+        CHECK(!verifySolution(state, std::vector<Move>(undo.begin(), undo.end() - 1)));
+
+        // the scramble text parses back to the same moves
+        std::vector<Move> parsed;
+        CHECK(parseMoves(formatMoves(moves, rank), rank, parsed));
+        CHECK(parsed == moves);
+    }
+}
+
+void testCompiledMoves(){
+    std::mt19937 rng(5);
+    for(int rank : {2, 3, 7, 20}){
+        std::vector<Move> moves = scramble(rank, 2000, rng);
+        CubeState turned(rank), compiled(rank), composed(rank);
+        applyMoves(turned, moves);
+        CompiledMoves(rank, moves).apply(compiled);
+        CHECK(turned == compiled);
+
+        CompiledMoves first(rank, std::vector<Move>(moves.begin(), moves.begin() + 1000));
+        CompiledMoves second(rank, std::vector<Move>(moves.begin() + 1000, moves.end()));
+        CHECK(first.append(second));
+        first.apply(composed);
+        CHECK(turned == composed);
+    }
+    // ranks do not mix
+    CompiledMoves three(3), four(4);
+    CHECK(!three.append(four));
+    CubeState state(4);
+    CHECK(!three.apply(state));
+}
+
+int main(){
+    testParseFormat();
+    testSimplify();
+    testScrambleVerify();
+    testCompiledMoves();
+    return checkResult();
+}
@@ -0,0 +1,163 @@
+// Corner pattern database, optimal 3x3x3 search & 2x2x2 enumeration on the thread pool
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include "cubie_cube.h"
+#include "two_phase.h"
+#include "thread_pool.h"
+#include "parallel_search.h"
+#include "check.h"
+
+typedef std::chrono::steady_clock Clock;
+
+double secondsSince(Clock::time_point start){
+    return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+CubieCube randomCube(int length, std::mt19937& rng){
+    CubieCube cube;
+    for(int ix = 0, last = -1; ix != length; ++ix){
+        int m;
+        do m = int(rng() % CubieCube::NUM_MOVES); while(TwoPhaseSolver::redundant(m, last));
+        cube.move(m);
+        last = m;
+    }
+    return cube;
+}
+
+// plain iterative deepening, no pruning tables: the true distance of close states
+bool reaches(const CubieCube& cube, int depth, int last){
+    if(depth == 0) return cube.solved();
+    for(int m = 0; m != CubieCube::NUM_MOVES; ++m){
+        if(TwoPhaseSolver::redundant(m, last)) continue;
+        CubieCube next = cube;
+        next.move(m);
+        if(reaches(next, depth - 1, m)) return true;
+    }
+    return false;
+}
+
+int bruteForceDistance(const CubieCube& cube){
+    int depth = 0;
+    while(!reaches(cube, depth, -1)) ++depth;
+    return depth;
+}
+
+void testCube2(ThreadPool& pool){
+    const std::uint64_t face_turns[] = {1, 9, 54, 321, 1847, 9992, 50136, 227536, 870072, 1887748, 623800, 2644};
+    std::vector<std::uint64_t> counts = enumerateCube2(pool);
+    CHECK(counts == std::vector<std::uint64_t>(face_turns, face_turns + 12));
+
+    counts = enumerateCube2(pool, true);
+    CHECK(counts.size() == 15 && counts.back() == 276);
+    std::uint64_t total = 0;
+    for(std::uint64_t count : counts) total += count;
+    CHECK(total == 3674160);
+}
+
+void testCornerTable(const CornerTable& corners){
+    // the known distance distribution of the corners in face turns
+    const std::uint64_t expected[] = {1, 18, 243, 2874, 28000, 205416, 1168516, 5402628,
+                                      20776176, 45391616, 15139616, 64736};
+    std::vector<std::uint64_t> counts(16, 0);
+    for(int cperm = 0; cperm != CubeCoordinates::N_CPERM; ++cperm)
+        for(int twist = 0; twist != CubeCoordinates::N_TWIST; ++twist)
+            ++counts[corners.distance(cperm, twist)];
+    counts.resize(12);
+    CHECK(counts == std::vector<std::uint64_t>(expected, expected + 12));
+
+    const char* path = "test_parallel_search_corners.tbl";
+    CHECK(corners.save(path));
+    CornerTable loaded;
+    CHECK(loaded.load(path, true));
+    CHECK(loaded.distance(12345, 678) == corners.distance(12345, 678));
+    CHECK(!loaded.load("test_parallel_search_missing.tbl"));
+    std::remove(path);
+}
+
+void testOptimal(const TwoPhaseTables& tables, const CornerTable& corners, ThreadPool& pool){
+    OptimalSolver solver(tables, corners, pool, 2);
+    std::mt19937 rng(23);
+    for(int k = 0; k != 30; ++k){
+        CubieCube cube = randomCube(1 + k % 6, rng);
+        std::vector<int> solution;
+        CHECK(solver.solve(cube, solution));
+        CHECK(int(solution.size()) == bruteForceDistance(cube));
+        for(int m : solution) cube.move(m);
+        CHECK(cube.solved());
+    }
+
+    std::vector<int> solution;
+    CHECK(solver.solve(CubieCube(), solution) && solution.empty());
+    CubieCube twisted;
+    twisted.setCorner(0, 0, 1);
+    CHECK(!solver.solve(twisted, solution));
+    // a 10 turn scramble has no solution of 3 turns
+    CHECK(!solver.solve(randomCube(10, rng), solution, 3));
+}
+
+/*
+ * The same optimal solves on 1, 2, 4, ... threads. The solution lengths
+ * have to agree; the speedup is only reported, since wall clock times
+ * depend on whatever else runs, e.g. the other tests under ctest -j.
+ * Set MAGIC_CUBE_CHECK_SCALING on an otherwise idle machine with at least
+ * 4 hardware threads to also require more than 2x on 4 threads.
+ */
+void testScaling(const TwoPhaseTables& tables, const CornerTable& corners){
+    std::mt19937 rng(29);
+    std::vector<CubieCube> cubes;
+    for(int k = 0; k != 4; ++k) cubes.push_back(randomCube(13, rng));
+
+    unsigned hardware = std::max(1u, std::thread::hardware_concurrency());
+    bool check_speedup = std::getenv("MAGIC_CUBE_CHECK_SCALING") != nullptr;
+    if(check_speedup && hardware < 4)
+        std::cout << "MAGIC_CUBE_CHECK_SCALING ignored, only " << hardware << " hardware thread(s)" << std::endl;
+    std::vector<std::size_t> lengths;
+    double single = 0;
+    for(unsigned threads = 1; threads <= std::max(4u, std::min(hardware, 32u)); threads *= 2){
+        ThreadPool pool(threads);
+        OptimalSolver solver(tables, corners, pool, 3);
+        Clock::time_point start = Clock::now();
+        std::uint64_t nodes = 0;
+        std::vector<std::size_t> found;
+        for(const CubieCube& cube : cubes){
+            std::vector<int> solution;
+            CHECK(solver.solve(cube, solution));
+            found.push_back(solution.size());
+            nodes += solver.visited();
+        }
+        double seconds = secondsSince(start);
+        if(threads == 1){
+            single = seconds;
+            lengths = found;
+        }
+        CHECK(found == lengths);
+        std::cout << threads << " threads: " << seconds << " s, " << nodes / seconds << " nodes/s, speedup "
+                  << single / seconds << std::endl;
+        if(check_speedup && threads == 4 && hardware >= 4) CHECK(single / seconds > 2.0);
+    }
+}
+
+int main(){
+    ThreadPool pool;
+    testCube2(pool);
+
+    Clock::time_point start = Clock::now();
+    CornerTable corners;
+    corners.generate(pool);
+    std::cout << "corner table built in " << secondsSince(start) << " s on " << pool.size() << " threads" << std::endl;
+    testCornerTable(corners);
+
+    TwoPhaseTables tables;
+    tables.generate();
+    testOptimal(tables, corners, pool);
+    testScaling(tables, corners);
+    return checkResult();
+}
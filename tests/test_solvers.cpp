@@ -0,0 +1,109 @@
+// Two-phase & reduction solvers, and the batch front end, on tables built in memory
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "cube_state.h"
+#include "cube_moves.h"
+#include "cubie_cube.h"
+#include "two_phase.h"
+#include "reduction.h"
+#include "batch_solver.h"
+#include "thread_pool.h"
+#include "check.h"
+
+void testTwoPhase(const TwoPhaseTables& tables){
+    TwoPhaseSolver solver(tables);
+    std::mt19937 rng(5);
+    for(int k = 0; k != 30; ++k){
+        CubieCube cube;
+        for(int ix = 0; ix != 40; ++ix) cube.move(int(rng() % CubieCube::NUM_MOVES));
+        std::vector<int> solution;
+        CHECK(solver.solve(cube, solution, 21, 2000.0));
+        CHECK(solution.size() <= 24);
+        for(int m : solution) cube.move(m);
+        CHECK(cube.solved());
+    }
+
+    std::vector<int> solution;
+    CHECK(solver.solve(CubieCube(), solution) && solution.empty());
+    CubieCube twisted;
+    twisted.setCorner(0, 0, 1);
+    CHECK(!solver.solve(twisted, solution));
+}
+
+void testReduction(const TwoPhaseTables& tables){
+    std::mt19937 rng(7);
+    for(int rank = 2; rank <= 7; ++rank){
+        for(int k = 0; k != 3; ++k){
+            CubeState state(rank);
+            applyMoves(state, scramble(rank, 20 * rank, rng));
+            std::vector<Move> moves;
+            ReductionSolver solver(tables);
+            CHECK(solver.solve(state, moves));
+            CHECK(verifySolution(state, moves));
+        }
+    }
+
+    // one edge flipped in place is no state of a real cube
+    CubeState flipped(3);
+    int a = flipped.faceletIndex(FACE_TOP, 0, 1);
+    int b = -1;
+    Face f;
+    int g[3] = {0, 0, 0};
+    flipped.faceletGrid(a, f, g);
+    for(int face = 0; face != 6; ++face)
+        if(face != FACE_TOP && flipped.cubieFace(g[0], g[1], g[2], Face(face)) != FACE_TEXTURE_0)
+            b = flipped.faceletIndex(Face(face), g);
+    FaceTexture t = flipped.facelet(a);
+    flipped.setFacelet(a, flipped.facelet(b));
+    flipped.setFacelet(b, t);
+    std::vector<Move> moves;
+    ReductionSolver solver(tables);
+    CHECK(!solver.solve(flipped, moves));
+}
+
+void testBatch(const TwoPhaseTables& tables){
+    std::mt19937 rng(1);
+    std::vector<std::vector<Move>> scrambles;
+    std::string input;
+    for(int k = 0; k != 40; ++k){
+        scrambles.push_back(scramble(3, 25, rng));
+        input += formatMoves(scrambles.back(), 3) + "\n";
+    }
+    input += "R Q\n";
+
+    std::istringstream in(input);
+    std::ostringstream out;
+    ThreadPool pool(4);
+    BatchSolver batch(tables, pool, 3, 8);
+    BatchSolver::Stats stats = batch.run(in, out);
+    CHECK(stats.solved == scrambles.size());
+    CHECK(stats.failed == 1);
+
+    // one output line per input line, in input order
+    std::istringstream result(out.str());
+    std::string line;
+    std::size_t ix = 0;
+    while(std::getline(result, line)){
+        if(ix < scrambles.size()){
+            CubeState state(3);
+            applyMoves(state, scrambles[ix]);
+            std::vector<Move> moves;
+            CHECK(parseMoves(line, 3, moves) && verifySolution(state, moves));
+        }
+        ++ix;
+    }
+    CHECK(ix == scrambles.size() + 1);
+}
+
+int main(){
+    TwoPhaseTables tables;
+    tables.generate();
+    CHECK(tables.ready());
+    testTwoPhase(tables);
+    testReduction(tables);
+    testBatch(tables);
+    return checkResult();
+}
@@ -0,0 +1,120 @@
+// The two-phase table file: save, load, verify, resume and recovery from bad files
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include "two_phase.h"
+#include "check.h"
+
+const char* PATH = "test_table_file.tbl";
+const char* COPY_PATH = "test_table_file_copy.tbl";
+
+std::vector<char> readFile(const char* path){
+    std::vector<char> bytes;
+    FILE* file = std::fopen(path, "rb");
+    if(!file) return bytes;
+    char block[1 << 16];
+    std::size_t n;
+    while((n = std::fread(block, 1, sizeof(block), file)) != 0) bytes.insert(bytes.end(), block, block + n);
+    std::fclose(file);
+    return bytes;
+}
+
+void writeFile(const char* path, const std::vector<char>& bytes){
+    FILE* file = std::fopen(path, "wb");
+    if(!file) return;
+    std::fwrite(bytes.data(), 1, bytes.size(), file);
+    std::fclose(file);
+}
+
+// same tables as a fresh build, compared move by move on a few coordinates
+bool sameTables(const TwoPhaseTables& a, const TwoPhaseTables& b){
+    for(int ix = 0; ix < CubeCoordinates::N_TWIST * TwoPhaseTables::NUM_MOVES; ix += 13){
+        if(a.twist_move[ix] != b.twist_move[ix]) return false;
+    }
+    for(int ix = 0; ix < CubeCoordinates::N_SPERM * CubeCoordinates::N_EPERM; ix += 101){
+        if(TwoPhaseTables::distance(a.sperm_eperm_prune, ix) != TwoPhaseTables::distance(b.sperm_eperm_prune, ix))
+            return false;
+    }
+    return true;
+}
+
+// each check maps the file only for its own duration, so it can be rewritten in between
+bool loads(const char* path, bool verify = false){
+    TwoPhaseTables tables;
+    return tables.load(path, verify);
+}
+
+bool generates(const char* path, bool load_first = false){
+    TwoPhaseTables tables;
+    return load_first ? tables.loadOrGenerate(path) : tables.generate(path);
+}
+
+int main(){
+    std::remove(PATH);
+    std::remove(COPY_PATH);
+
+    TwoPhaseTables memory;
+    memory.generate();
+    CHECK(memory.save(COPY_PATH));
+
+    // missing file, then generated & saved by the loader
+    CHECK(!loads(PATH));
+    CHECK(generates(PATH, true));
+    const std::vector<char> good = readFile(PATH);
+    CHECK(!good.empty());
+
+    // a generated file is the same as saved tables built in memory
+    CHECK(readFile(COPY_PATH) == good);
+    {
+        TwoPhaseTables loaded;
+        CHECK(loaded.load(PATH, true));
+        CHECK(sameTables(loaded, memory));
+    }
+
+    // a flipped byte in a table only shows when verifying, and is rebuilt by generate
+    std::vector<char> bytes = good;
+    bytes[bytes.size() - 1000] ^= 0x5a;
+    writeFile(PATH, bytes);
+    CHECK(loads(PATH));
+    CHECK(!loads(PATH, true));
+    CHECK(generates(PATH));
+    CHECK(readFile(PATH) == good);
+
+    // an interrupted run: complete tables are kept, the rest built again
+    bytes.assign(good.begin(), good.begin() + good.size() / 2);
+    writeFile(PATH, bytes);
+    CHECK(!loads(PATH));
+    CHECK(generates(PATH));
+    CHECK(readFile(PATH) == good);
+    CHECK(loads(PATH, true));
+
+    // another version or move set is started over
+    bytes = good;
+    bytes[8] ^= 1;
+    writeFile(PATH, bytes);
+    CHECK(!loads(PATH));
+    CHECK(generates(PATH, true));
+    CHECK(readFile(PATH) == good);
+
+    // junk, and trailing bytes after complete tables, are truncated away
+    writeFile(PATH, std::vector<char>(1 << 20, 7));
+    CHECK(!loads(PATH));
+    CHECK(generates(PATH, true));
+    CHECK(readFile(PATH) == good);
+    bytes = good;
+    bytes.insert(bytes.end(), 100, 0);
+    writeFile(PATH, bytes);
+    CHECK(!loads(PATH));
+    CHECK(generates(PATH, true));
+    CHECK(readFile(PATH) == good);
+    {
+        TwoPhaseTables loaded;
+        CHECK(loaded.load(PATH, true));
+        CHECK(sameTables(loaded, memory));
+    }
+
+    std::remove(PATH);
+    std::remove(COPY_PATH);
+    return checkResult();
+}